@@ -20,6 +20,7 @@ static retro_environment_t environ_cb;
 
 extern uint64_t joy;
 static bool can_dupe;
+static enum retro_pixel_format pixel_format = RETRO_PIXEL_FORMAT_0RGB1555;
 
 uint8_t libretro_save_buf[0x20000 + 0x2000];	/* Workaround for broken-by-design GBA save semantics. */
 
@@ -121,6 +122,17 @@ void retro_set_controller_port_device(unsigned port, unsigned device)
 void retro_set_environment(retro_environment_t cb)
 {
    environ_cb = cb;
+
+   static const struct retro_variable vars[] = {
+      { "vbanext_headless", "Headless mode (no video or audio); disabled|enabled" },
+      { "vbanext_color_correction", "Color correction; disabled|enabled" },
+      { "vbanext_frame_blend", "Interframe blending; disabled|enabled" },
+      { "vbanext_audio_flush", "Audio flush interval; 10ms|scanline|frame" },
+      { "vbanext_frontend_framebuffer", "Draw into frontend framebuffer (no line reuse or dupes); disabled|enabled" },
+      { NULL, NULL },
+   };
+
+   cb(RETRO_ENVIRONMENT_SET_VARIABLES, (void*)vars);
 }
 
 void retro_get_system_info(struct retro_system_info *info)
@@ -148,10 +160,20 @@ void retro_init(void)
    adjust_save_ram();
    environ_cb(RETRO_ENVIRONMENT_GET_CAN_DUPE, &can_dupe);
 
-#ifdef FRONTEND_SUPPORTS_RGB565
+#if defined(FRONTEND_SUPPORTS_XRGB8888)
+   enum retro_pixel_format xrgb8888 = RETRO_PIXEL_FORMAT_XRGB8888;
+   if(environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &xrgb8888))
+   {
+      pixel_format = xrgb8888;
+      fprintf(stderr, "Frontend supports XRGB8888 - will use that instead of XRGB1555.\n");
+   }
+#elif defined(FRONTEND_SUPPORTS_RGB565)
    enum retro_pixel_format rgb565 = RETRO_PIXEL_FORMAT_RGB565;
    if(environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &rgb565))
+   {
+      pixel_format = rgb565;
       fprintf(stderr, "Frontend supports RGB565 - will use that instead of XRGB1555.\n");
+   }
 #endif
 }
 
@@ -347,7 +369,11 @@ static void gba_init(void)
    free(state_buf);
 }
 
-void retro_deinit(void) {}
+void retro_deinit(void)
+{
+   // joins the render thread of THREADED_RENDER builds
+   CPUSetDeferredRender(false);
+}
 
 void retro_reset(void)
 {
@@ -368,6 +394,61 @@ static const unsigned binds[] = {
 };
 
 static unsigned has_frame;
+static bool headless;
+static bool frontend_framebuffer;
+
+static void check_variables(void)
+{
+   struct retro_variable var;
+
+   var.key = "vbanext_headless";
+   var.value = NULL;
+
+   headless = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      headless = !strcmp(var.value, "enabled");
+
+   CPUSetHeadless(headless);
+
+   var.key = "vbanext_color_correction";
+   var.value = NULL;
+
+   bool color_correction = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      color_correction = !strcmp(var.value, "enabled");
+
+   CPUSetColorCorrection(color_correction);
+
+   var.key = "vbanext_frame_blend";
+   var.value = NULL;
+
+   bool frame_blend = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      frame_blend = !strcmp(var.value, "enabled");
+
+   CPUSetFrameBlend(frame_blend);
+
+   var.key = "vbanext_audio_flush";
+   var.value = NULL;
+
+   int flush_ticks = 167772;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "scanline"))
+         flush_ticks = 1232;
+      else if (!strcmp(var.value, "frame"))
+         flush_ticks = 280896;
+   }
+
+   soundSetFlushTicks(flush_ticks);
+
+   var.key = "vbanext_frontend_framebuffer";
+   var.value = NULL;
+
+   frontend_framebuffer = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      frontend_framebuffer = !strcmp(var.value, "enabled");
+}
 
 void retro_run(void)
 {
@@ -380,6 +461,22 @@ void retro_run(void)
 
    joy = J;
 
+   bool updated = false;
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
+      check_variables();
+
+   /* draw this run's frame straight into the frontend's buffer when it has
+    * one; lines drawn there are not kept, so every line is drawn again and
+    * no frame is duped */
+   struct retro_framebuffer fb = {0};
+   fb.width = 240;
+   fb.height = 160;
+   fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+   if(frontend_framebuffer && !headless
+         && environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb) && fb.data
+         && fb.format == pixel_format && !(fb.pitch % sizeof(pixel_t)))
+      CPUSetFrameBuffer(fb.data, fb.pitch);
+
    has_frame = 0;
    do { CPULoop(); } while (!has_frame);
 }
@@ -410,6 +507,7 @@ bool retro_load_game(const struct retro_game_info *game)
    bool ret = CPULoadRom(game->path);
 
    gba_init();
+   check_variables();
 
    return ret;
 }
@@ -446,9 +544,15 @@ void systemOnWriteDataToSoundBuffer(int16_t *finalWave, int length)
 
 void systemDrawScreen()
 {
-   video_cb(pix, 240, 160, 512); //last arg is pitch
-   g_video_frames++;
    has_frame = 1;
+
+   /* headless frames are not drawn; without dupes the frontend gets the
+    * last one that was */
+   if (can_dupe && (headless || !CPUFrameChanged()))
+      video_cb(NULL, 240, 160, pixPitch * sizeof(pixel_t));
+   else
+      video_cb(pixOut, 240, 160, pixPitch * sizeof(pixel_t)); //last arg is pitch
+   g_video_frames++;
 }
 
 void systemMessage(const char* str, ...)
@@ -452,6 +452,16 @@ enum retro_mod
                                            // Result is set to true if some variables are updated by
                                            // frontend since last call to RETRO_ENVIRONMENT_GET_VARIABLE.
                                            // Variables should be queried with GET_VARIABLE.
+#define RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER (40 | RETRO_ENVIRONMENT_EXPERIMENTAL)
+                                           // struct retro_framebuffer * --
+                                           // Returns a preallocated framebuffer which the core can use for rendering
+                                           // the frame into when not using SET_HW_RENDER.
+                                           // The framebuffer returned from this call must not be used
+                                           // after the current call to retro_run() returns.
+                                           // The core sets width, height and access_flags; the frontend fills in
+                                           // data, pitch, format and memory_flags.
+                                           // If the call fails or format differs from the core's pixel format,
+                                           // the core renders into its own buffer as usual.
 
 // Pass this to retro_video_refresh_t if rendering to hardware.
 // Passing NULL to retro_video_refresh_t is still a frame dupe as normal.
@@ -568,6 +578,23 @@ enum retro_pixel_format
    RETRO_PIXEL_FORMAT_UNKNOWN  = INT_MAX
 };
 
+#define RETRO_MEMORY_ACCESS_WRITE (1 << 0)	// The core will write to the buffer provided by retro_framebuffer::data.
+#define RETRO_MEMORY_ACCESS_READ (1 << 1)	// The core will read from retro_framebuffer::data.
+#define RETRO_MEMORY_TYPE_CACHED (1 << 0)	// The memory in data is cached.
+						// If not cached, random writes and/or reading from the buffer is expected to be very slow.
+
+struct retro_framebuffer
+{
+   void *data;                      // The framebuffer which the core can render into. Set by frontend in GET_CURRENT_SOFTWARE_FRAMEBUFFER.
+   unsigned width;                  // The framebuffer width used by the core. Set by core.
+   unsigned height;                 // The framebuffer height used by the core. Set by core.
+   size_t pitch;                    // The number of bytes between the beginning of a scanline and beginning of the next scanline.
+                                    // Set by frontend in GET_CURRENT_SOFTWARE_FRAMEBUFFER.
+   unsigned access_flags;           // How the core will access the memory in the framebuffer. RETRO_MEMORY_ACCESS_* flags. Set by core.
+   enum retro_pixel_format format;  // The pixel format the frontend uses for data. Set by frontend.
+   unsigned memory_flags;           // How the framebuffer was allocated. RETRO_MEMORY_TYPE_* flags. Set by frontend.
+};
+
 struct retro_message
 {
    const char *msg;        // Message to be displayed.
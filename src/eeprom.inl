@@ -180,3 +180,83 @@ void eepromWrite(u8 value)
 			break;
 	}
 }
+
+/* Whole-command fast paths used by DMA. They leave the state machine
+ * exactly where the bit-serial eepromWrite()/eepromRead() calls would,
+ * and return false for anything that isn't a complete command, which
+ * then goes through the serial path. */
+
+#define EEPROM_BIT(stream, i) (READ16LE(&(stream)[i]) & 1)
+
+bool eepromWriteBlock(const u16 *stream, int count)
+{
+	int addressBits;
+
+	if(eepromMode != EEPROM_IDLE)
+		return false;
+
+	if(count == 0x11 || count == 0x51)
+		addressBits = 0x11;
+	else if(count == 9 || count == 0x49)
+		addressBits = 9;
+	else
+		return false;
+
+	bool read = EEPROM_BIT(stream, 1) != 0;
+	if(read != (count == addressBits))
+		return false;
+
+	eepromBuffer[0] = EEPROM_BIT(stream, 0);
+	for(int i = 1; i < addressBits; i++)
+		eepromBuffer[i >> 3] = (eepromBuffer[i >> 3] << 1) | EEPROM_BIT(stream, i);
+
+	eepromInUse = true;
+	if(addressBits == 0x11)
+	{
+		eepromSize = 0x2000;
+		eepromAddress = ((eepromBuffer[0] & 0x3F) << 8) | eepromBuffer[1];
+	}
+	else
+		eepromAddress = eepromBuffer[0] & 0x3F;
+
+	eepromByte = 0;
+	eepromBits = 0;
+
+	if(read)
+	{
+		eepromMode = EEPROM_READDATA;
+		return true;
+	}
+
+	// the bit that completed the address is also the first data bit
+	stream += addressBits - 1;
+	eepromBuffer[0] = EEPROM_BIT(stream, 0);
+	for(int i = 1; i < 0x40; i++)
+		eepromBuffer[i >> 3] = (eepromBuffer[i >> 3] << 1) | EEPROM_BIT(stream, i);
+
+	for(int i = 0; i < 8; i++)
+		eepromData[(eepromAddress << 3) + i] = eepromBuffer[i];
+
+	// stop bit
+	eepromBuffer[8] = (eepromBuffer[8] << 1) | EEPROM_BIT(stream, 0x40);
+	eepromMode = EEPROM_IDLE;
+	return true;
+}
+
+bool eepromReadBlock(u16 *stream, int count)
+{
+	if(eepromMode != EEPROM_READDATA || eepromBits != 0 || count != 0x44)
+		return false;
+
+	const u8 *data = &eepromData[eepromAddress << 3];
+
+	for(int i = 0; i < 4; i++)
+		WRITE16LE(&stream[i], 0);
+	for(int i = 0; i < 0x40; i++)
+		WRITE16LE(&stream[4 + i], (data[i >> 3] >> (7 - (i & 7))) & 1);
+
+	eepromMode = EEPROM_IDLE;
+	eepromByte = 8;
+	eepromBits = 0x40;
+	return true;
+}
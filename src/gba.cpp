@@ -20,6 +20,10 @@
 #include "elf.h"
 #endif
 
+#ifdef THREADED_RENDER
+#include <pthread.h>
+#endif
+
 /*============================================================
 	GBA INLINE
 ============================================================ */
@@ -215,18 +219,50 @@ static int clockTicks;
 
 static int romSize = 0x2000000;
 static u32 line[6][240];
-static bool gfxInWin[2][240];
+static u32 gfxInWin[2][8];		/* WIN0H/WIN1H spans, bit x for pixel x */
 static int lineOBJpixleft[128];
 uint64_t joy = 0;
 
 static int gfxBG2Changed = 0;
 static int gfxBG3Changed = 0;
 
+static void mode0RenderLine(void);
+static void (*renderLine)(void) = mode0RenderLine;
+static bool render_line_all_enabled = false;
+static int render_line_mode = 0;
+
 static int gfxBG2X = 0;
 static int gfxBG2Y = 0;
 static int gfxBG3X = 0;
 static int gfxBG3Y = 0;
 
+/* What the renderers draw a line from, taken by gfxViewSave() when the
+ * line is due. The frame journal can hold it back and load it later, on
+ * the render thread with THREADED_RENDER, while the CPU goes on changing
+ * the registers it was taken from. */
+typedef struct
+{
+	void (*renderLine)(void);
+	bool allEnabled;
+	int mode;
+	u16 io[REG_BLDY + 1];
+	u16 MOSAIC, BLDMOD, COLEV, COLY;
+	u16 BG2X_L, BG2X_H, BG2Y_L, BG2Y_H;
+	u16 BG3X_L, BG3X_H, BG3Y_L, BG3Y_H;
+	int layerEnable;
+	u32 inWin[2][8];
+	int bg2Changed, bg3Changed;	/* affine reference points to reload */
+} gfx_view_t;
+
+static gfx_view_t gfxView;
+static bool colorCorrection = false;	/* colorLUT holds LCD corrected colours */
+
+/* the memory the renderers draw from: the machine's own, or the render
+ * thread's copy with THREADED_RENDER */
+static u8 *gfxVram = NULL;
+static u8 *gfxOam = NULL;
+static u8 *gfxPaletteRAM = NULL;
+
 static bool ioReadable[0x400];
 static int gbaSaveType = 0; // used to remember the save type on reset
 
@@ -366,6 +402,8 @@ static int timer3ClockReload  = 0;
 
 static const u32  objTilesAddress [3] = {0x010000, 0x014000, 0x014000};
 
+#include "gba_dirty.inl"
+
 static INLINE u32 CPUReadMemory(u32 address)
 {
 	u32 value;
@@ -645,6 +683,8 @@ static INLINE void CPUWriteMemory(u32 address, u32 value)
 			}
 			break;
 		case 0x05:
+			if(dirtyConsumerCount && READ32LE(((u32 *)&graphics.paletteRAM[address & 0x3FC])) != value)
+				dirtyMarkPalette(address & 0x3FC, 4);
 			WRITE32LE(((u32 *)&graphics.paletteRAM[address & 0x3FC]), value);
 			break;
 		case 0x06:
@@ -654,10 +694,13 @@ static INLINE void CPUWriteMemory(u32 address, u32 value)
 			if ((address & 0x18000) == 0x18000)
 				address &= 0x17fff;
 
-
+			if(dirtyConsumerCount && READ32LE(((u32 *)&vram[address])) != value)
+				dirtyMarkVram(address, 4);
 			WRITE32LE(((u32 *)&vram[address]), value);
 			break;
 		case 0x07:
+			if(dirtyConsumerCount && READ32LE(((u32 *)&oam[address & 0x3fc])) != value)
+				dirtyMarkOam(address & 0x3fc, 4);
 			WRITE32LE(((u32 *)&oam[address & 0x3fc]), value);
 			break;
 		case 0x0D:
@@ -690,6 +733,8 @@ static INLINE void CPUWriteHalfWord(u32 address, u16 value)
 				CPUUpdateRegister(address & 0x3fe, value);
 			break;
 		case 5:
+			if(dirtyConsumerCount && READ16LE(((u16 *)&graphics.paletteRAM[address & 0x3fe])) != value)
+				dirtyMarkPalette(address & 0x3fe, 2);
 			WRITE16LE(((u16 *)&graphics.paletteRAM[address & 0x3fe]), value);
 			break;
 		case 6:
@@ -698,9 +743,13 @@ static INLINE void CPUWriteHalfWord(u32 address, u16 value)
 				return;
 			if ((address & 0x18000) == 0x18000)
 				address &= 0x17fff;
+			if(dirtyConsumerCount && READ16LE(((u16 *)&vram[address])) != value)
+				dirtyMarkVram(address, 2);
 			WRITE16LE(((u16 *)&vram[address]), value);
 			break;
 		case 7:
+			if(dirtyConsumerCount && READ16LE(((u16 *)&oam[address & 0x3fe])) != value)
+				dirtyMarkOam(address & 0x3fe, 2);
 			WRITE16LE(((u16 *)&oam[address & 0x3fe]), value);
 			break;
 		case 8:
@@ -805,6 +854,8 @@ static INLINE void CPUWriteByte(u32 address, u8 b)
 			break;
 		case 5:
 			// no need to switch
+			if(dirtyConsumerCount && *((u16 *)&graphics.paletteRAM[address & 0x3FE]) != ((b << 8) | b))
+				dirtyMarkPalette(address & 0x3FE, 2);
 			*((u16 *)&graphics.paletteRAM[address & 0x3FE]) = (b << 8) | b;
 			break;
 		case 6:
@@ -817,7 +868,11 @@ static INLINE void CPUWriteByte(u32 address, u8 b)
 			// no need to switch
 			// byte writes to OBJ VRAM are ignored
 			if ((address) < objTilesAddress[((io_registers[REG_DISPCNT] & 7)+1)>>2])
+			{
+				if(dirtyConsumerCount && *((u16 *)&vram[address]) != ((b << 8) | b))
+					dirtyMarkVram(address, 2);
 				*((u16 *)&vram[address]) = (b << 8) | b;
+			}
 			break;
 		case 7:
 			// no need to switch
@@ -1115,6 +1170,7 @@ static void CPUSoftwareInterrupt(int comment)
 
 #include "gba_thumb_cpuexec.inl"
 
+#include "gba_simd.inl"
 #include "gba_gfx.inl"
 
 /*============================================================
@@ -1136,7 +1192,14 @@ u8 *rom = 0;
 u8 *internalRAM = 0;
 u8 *workRAM = 0;
 u8 *vram = 0;
-u16 *pix = 0;
+pixel_t *pix = 0;
+pixel_t colorLUT[0x8000 + 2];
+pixel_t *pixOut = 0;		/* where the lines of the frame go: pix or a frontend buffer */
+unsigned pixPitch = PIX_BUFFER_SCREEN_WIDTH;
+static bool frameBlend = false;
+static pixel_t *frameBlendBuffer = NULL;	/* the blended frame, when the frontend gives no buffer */
+static pixel_t *frameBlendOut = NULL;		/* where blended lines go */
+static unsigned frameBlendPitch = PIX_BUFFER_SCREEN_WIDTH;
 u8 *oam = 0;
 u8 *ioMem = 0;
 
@@ -1484,22 +1547,10 @@ static INLINE int CPUUpdateTicks (void)
 }
 
 #define CPUUpdateWindow0() \
-{ \
-  int x00_window0 = io_registers[REG_WIN0H] >>8; \
-  int x01_window0 = io_registers[REG_WIN0H] & 255; \
-  int x00_lte_x01 = x00_window0 <= x01_window0; \
-  for(int i = 0; i < 240; i++) \
-      gfxInWin[0][i] = ((i >= x00_window0 && i < x01_window0) & x00_lte_x01) | ((i >= x00_window0 || i < x01_window0) & ~x00_lte_x01); \
-}
+  gfxWindowSpan(gfxInWin[0], io_registers[REG_WIN0H] >> 8, io_registers[REG_WIN0H] & 255)
 
 #define CPUUpdateWindow1() \
-{ \
-  int x00_window1 = io_registers[REG_WIN1H]>>8; \
-  int x01_window1 = io_registers[REG_WIN1H] & 255; \
-  int x00_lte_x01 = x00_window1 <= x01_window1; \
-  for(int i = 0; i < 240; i++) \
-   gfxInWin[1][i] = ((i >= x00_window1 && i < x01_window1) & x00_lte_x01) | ((i >= x00_window1 || i < x01_window1) & ~x00_lte_x01); \
-}
+  gfxWindowSpan(gfxInWin[1], io_registers[REG_WIN1H] >> 8, io_registers[REG_WIN1H] & 255)
 
 #define CPUCompareVCOUNT() \
   if(io_registers[REG_VCOUNT] == (io_registers[REG_DISPSTAT] >> 8)) \
@@ -1529,6 +1580,8 @@ unsigned CPUWriteState(u8* data, unsigned size)
 {
 	u8 *orig = data;
 
+	frameJournalFlush();
+
 	utilWriteIntMem(data, SAVE_GAME_VERSION);
 	utilWriteMem(data, &rom[0xa0], 16);
 	utilWriteIntMem(data, useBios);
@@ -1691,6 +1744,25 @@ static bool CPUIsELF(const char *file)
 
 static void CPUCleanUp (void)
 {
+	frameJournalStop();
+
+#ifdef THREADED_RENDER
+	if(gfxVram != NULL) {
+		free(gfxVram);
+		gfxVram = NULL;
+	}
+
+	if(gfxOam != NULL) {
+		free(gfxOam);
+		gfxOam = NULL;
+	}
+
+	if(gfxPaletteRAM != NULL) {
+		free(gfxPaletteRAM);
+		gfxPaletteRAM = NULL;
+	}
+#endif
+
 	if(rom != NULL) {
 		free(rom);
 		rom = NULL;
@@ -1724,6 +1796,14 @@ static void CPUCleanUp (void)
 	if(pix != NULL) {
 		free(pix);
 		pix = NULL;
+		pixOut = NULL;
+	}
+
+	if(frameBlendBuffer != NULL) {
+		free(frameBlendBuffer);
+		frameBlendBuffer = NULL;
+		frameBlendOut = NULL;
+		frameBlend = false;
 	}
 
 	if(oam != NULL) {
@@ -1735,6 +1815,12 @@ static void CPUCleanUp (void)
 		free(ioMem);
 		ioMem = NULL;
 	}
+
+	if(tileCache != NULL) {
+		dirtyUnregister(&tileCacheDirty);
+		free(tileCache);
+		tileCache = NULL;
+	}
 }
 
 int CPULoadRom(const char * file)
@@ -1801,16 +1887,45 @@ int CPULoadRom(const char * file)
 		CPUCleanUp();
 		return 0;
 	}
-	pix = (u16 *)calloc(1, 4 * PIX_BUFFER_SCREEN_WIDTH * 160);
+#ifdef THREADED_RENDER
+	gfxVram = (u8 *)calloc(1, 0x20000);
+	if(gfxVram == NULL) {
+		CPUCleanUp();
+		return 0;
+	}
+	gfxOam = (u8 *)calloc(1, 0x400);
+	if(gfxOam == NULL) {
+		CPUCleanUp();
+		return 0;
+	}
+	gfxPaletteRAM = (u8 *)calloc(1, 0x400);
+	if(gfxPaletteRAM == NULL) {
+		CPUCleanUp();
+		return 0;
+	}
+#else
+	gfxVram = vram;
+	gfxOam = oam;
+	gfxPaletteRAM = graphics.paletteRAM;
+#endif
+	pix = (pixel_t *)calloc(1, 4 * PIX_BUFFER_SCREEN_WIDTH * 160);
 	if(pix == NULL) {
 		CPUCleanUp();
 		return 0;
 	}
+	pixOut = pix;
+	pixPitch = PIX_BUFFER_SCREEN_WIDTH;
 	ioMem = (u8 *)calloc(1, 0x400);
 	if(ioMem == NULL) {
 		CPUCleanUp();
 		return 0;
 	}
+	tileCache = (u8 *)malloc(TILE_CACHE_SIZE);
+	if(tileCache == NULL) {
+		CPUCleanUp();
+		return 0;
+	}
+	tileCacheTracked = dirtyRegister(&tileCacheDirty);
 
 	flashInit();
 	eepromInit();
@@ -1840,7 +1955,7 @@ void doMirroring (bool b)
 	}
 }
 
-#include "gba_modes.inl"
+#include "gba_composite.inl"
 
 #include "gba_mode0.inl"
 #include "gba_mode1.inl"
@@ -1849,11 +1964,10 @@ void doMirroring (bool b)
 #include "gba_mode4.inl"
 #include "gba_mode5.inl"
 
-static void (*renderLine)(void) = mode0RenderLine;
-static bool render_line_all_enabled = false;
-
 #define CPUUpdateRender() \
   render_line_all_enabled = false; \
+  if((io_registers[REG_DISPCNT] & 7) < 6) \
+    render_line_mode = io_registers[REG_DISPCNT] & 7; \
   switch(io_registers[REG_DISPCNT] & 7) { \
   case 0: \
     if((!fxOn && !windowOn && !(graphics.layerEnable & 0x8000))) \
@@ -1916,8 +2030,91 @@ static bool render_line_all_enabled = false;
     } \
   }
 
+#include "gba_reuse.inl"
+
+/* With interframe blending pix keeps the frame as drawn and the line
+ * that goes out mixes it with the line it replaced */
+static INLINE void frameBlendLine(bool drawn)
+{
+	if(!frameBlend)
+		return;
+
+	u32 y = gfxView.io[REG_VCOUNT];
+	pixel_t *cur = &pix[PIX_BUFFER_SCREEN_WIDTH * y];
+	gfxBlendFrameLine(&frameBlendOut[frameBlendPitch * y], cur, drawn ? lineReuseOld : cur);
+}
+
+static void gfxViewSave(gfx_view_t *v)
+{
+	v->renderLine = renderLine;
+	v->allEnabled = render_line_all_enabled;
+	v->mode = render_line_mode;
+	memcpy(v->io, io_registers, sizeof(v->io));
+	v->MOSAIC = MOSAIC;
+	v->BLDMOD = BLDMOD;
+	v->COLEV = COLEV;
+	v->COLY = COLY;
+	v->BG2X_L = BG2X_L;
+	v->BG2X_H = BG2X_H;
+	v->BG2Y_L = BG2Y_L;
+	v->BG2Y_H = BG2Y_H;
+	v->BG3X_L = BG3X_L;
+	v->BG3X_H = BG3X_H;
+	v->BG3Y_L = BG3Y_L;
+	v->BG3Y_H = BG3Y_H;
+	v->layerEnable = graphics.layerEnable;
+	memcpy(v->inWin, gfxInWin, sizeof(v->inWin));
+	v->bg2Changed = gfxBG2Changed;
+	v->bg3Changed = gfxBG3Changed;
+	gfxBG2Changed = 0;
+	gfxBG3Changed = 0;
+}
+
+/* reloads the renderers have not done yet (the line was reused or the
+ * BG was off) stay pending */
+static INLINE void gfxViewLoad(const gfx_view_t *v)
+{
+	int bg2Changed = gfxView.bg2Changed | v->bg2Changed;
+	int bg3Changed = gfxView.bg3Changed | v->bg3Changed;
+	gfxView = *v;
+	gfxView.bg2Changed = bg2Changed;
+	gfxView.bg3Changed = bg3Changed;
+}
+
+/* draws the line gfxView holds */
+static void CPUDrawLine(void)
+{
+	if(lineReuseBegin())
+	{
+		frameBlendLine(false);
+		return;
+	}
+
+	bool draw_objwin = (gfxView.layerEnable & 0x9000) == 0x9000;
+	bool draw_sprites = gfxView.layerEnable & 0x1000;
+	memset(line[4], -1, 240 * sizeof(u32));	// erase all sprites
+
+	if(draw_sprites)
+		gfxDrawSprites();
+
+	if(gfxView.allEnabled)
+	{
+		memset(line[5], -1, 240 * sizeof(u32));	// erase all OBJ Win 
+		if(draw_objwin)
+			gfxDrawOBJWin();
+	}
+
+	(*gfxView.renderLine)();
+	lineReuseEnd();
+	frameBlendLine(true);
+}
+
+#include "gba_journal.inl"
+
 bool CPUReadState(const u8* data, unsigned size)
 {
+	frameJournalFlush();
+
 	// Don't really care about version.
 	int version = utilReadIntMem(data);
 	if (version != SAVE_GAME_VERSION)
@@ -1953,6 +2150,9 @@ bool CPUReadState(const u8* data, unsigned size)
 	utilReadMem(oam, data, 0x400);
 	utilReadMem(pix, data, 4* PIX_BUFFER_SCREEN_WIDTH * 160);
 	utilReadMem(ioMem, data, 0x400);
+	dirtyMarkAll();
+	frameJournalReload();
+	lineReuseReset();
 
 	eepromReadGameMem(data, version);
 	flashReadGameMem(data, version);
@@ -2124,6 +2324,49 @@ static void CPUSwitchMode(int mode, bool saveState, bool breakLoop)
 
 
 
+static INLINE u16 *dmaRAMPointer(u32 address, u32 count)
+{
+	switch(address >> 24)
+	{
+		case 2:
+			if((address & 0x3FFFE) + (count << 1) <= 0x40000)
+				return (u16 *)&workRAM[address & 0x3FFFE];
+			break;
+		case 3:
+			if((address & 0x7FFE) + (count << 1) <= 0x8000)
+				return (u16 *)&internalRAM[address & 0x7FFE];
+			break;
+	}
+	return NULL;
+}
+
+// Moves a whole EEPROM command or read between RAM and the EEPROM in one
+// go instead of one bit per CPUWriteHalfWord()/CPUReadHalfWord().
+static bool doDMAEEPROM(u32 &s, u32 &d, u32 si, u32 di, u32 c)
+{
+	if(!cpuEEPROMEnabled)
+		return false;
+
+	if((d >> 24) == 0x0D && si == 2)
+	{
+		const u16 *src = dmaRAMPointer(s, c);
+		if(!src || !eepromWriteBlock(src, c))
+			return false;
+	}
+	else if((s >> 24) == 0x0D && di == 2)
+	{
+		u16 *dst = dmaRAMPointer(d, c);
+		if(!dst || !eepromReadBlock(dst, c))
+			return false;
+	}
+	else
+		return false;
+
+	s += si * c;
+	d += di * c;
+	return true;
+}
+
 void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
 {
 	int sm = s >> 24;
@@ -2177,7 +2420,7 @@ void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
 				c--;
 			}while(c != 0);
 		}
-		else
+		else if(!doDMAEEPROM(s, d, si, di, c))
 		{
 			do{
 				CPUWriteHalfWord(d, CPUReadHalfWord(s));
@@ -2391,16 +2634,7 @@ void CPUUpdateRegister(u32 address, u16 value)
 				CPUUpdateRender();
 				// we only care about changes in BG0-BG3
 				if(changeBG)
-				{
-					if(!(graphics.layerEnable & 0x0100))
-						memset(line[0], -1, 240 * sizeof(u32));
-					if(!(graphics.layerEnable & 0x0200))
-						memset(line[1], -1, 240 * sizeof(u32));
-					if(!(graphics.layerEnable & 0x0400))
-						memset(line[2], -1, 240 * sizeof(u32));
-					if(!(graphics.layerEnable & 0x0800))
-						memset(line[3], -1, 240 * sizeof(u32));
-				}
+					frameJournalClear((~graphics.layerEnable >> 8) & 0x0F);
 				break;
 			}
 		case 0x04:
@@ -2819,9 +3053,39 @@ void CPUUpdateRegister(u32 address, u16 value)
 	}
 }
 
+static u32 colorChannel(double v)
+{
+	u32 c = (u32)(pow(v / 255.0, 1.0 / 2.2) * (255.0 * 255.0 / 280.0) + 0.5);
+	return c > 255 ? 255 : c;
+}
+
+/* Fills colorLUT for CONVERT_COLOR. Correction darkens and mixes the
+ * channels the way the GBA's LCD shows them. */
+static void colorLUTBuild(void)
+{
+	for(u32 color = 0; color < 0x8000; color++)
+	{
+		if(!colorCorrection)
+		{
+			colorLUT[color] = PIXEL_FROM_BGR555(color);
+			continue;
+		}
+
+		double r = pow((color & 0x1f) / 31.0, 4.0);
+		double g = pow(((color >> 5) & 0x1f) / 31.0, 4.0);
+		double b = pow(((color >> 10) & 0x1f) / 31.0, 4.0);
+		u32 r8 = colorChannel(255 * r + 50 * g);
+		u32 g8 = colorChannel(10 * r + 230 * g + 30 * b);
+		u32 b8 = colorChannel(50 * r + 10 * g + 220 * b);
+		colorLUT[color] = ((r8 >> RED_EXPAND) << RED_SHIFT) | ((g8 >> GREEN_EXPAND) << GREEN_SHIFT)
+			| ((b8 >> BLUE_EXPAND) << BLUE_SHIFT);
+	}
+}
 
 void CPUInit(const char *biosFileName, bool useBiosFile)
 {
+	colorLUTBuild();
+
 #ifndef LSB_FIRST
 	if(!cpuBiosSwapped) {
 		for(unsigned int i = 0; i < sizeof(myROM)/4; i++) {
@@ -2946,10 +3210,16 @@ void CPUInit(const char *biosFileName, bool useBiosFile)
         address_lut[0x42] = &io_registers[REG_WIN1H];
         address_lut[0x44] = &io_registers[REG_WIN0V];
         address_lut[0x46] = &io_registers[REG_WIN1V];
+
+	lineReuseEnabled = dirtyRegister(&lineReuseDirty);
+	spriteLinesTracked = dirtyRegister(&spriteLinesDirty);
+	gfxPaletteOutTracked = dirtyRegister(&gfxPaletteOutDirty);
 }
 
 void CPUReset (void)
 {
+	frameJournalFlush();
+
 	if(gbaSaveType == 0)
 	{
 		if(eepromInUse)
@@ -2972,6 +3242,9 @@ void CPUReset (void)
 	memset(pix, 0, 4 * 160 * 240);			// clean picture
 	memset(vram, 0, 0x20000);			// clean vram
 	memset(ioMem, 0, 0x400);			// clean io memory
+	dirtyMarkAll();
+	frameJournalReload();
+	lineReuseReset();
 
 	io_registers[REG_DISPCNT]  = 0x0080;
 	io_registers[REG_DISPSTAT] = 0x0000;
@@ -3135,6 +3408,7 @@ void CPUReset (void)
 	dma3Dest = 0;
 	cpuSaveGameFunc = flashSaveDecide;
 	renderLine = mode0RenderLine;
+	render_line_mode = 0;
 	fxOn = false;
 	windowOn = false;
 	saveType = 0;
@@ -3272,6 +3546,152 @@ static void CPUInterrupt(void)
 	biosProtected[3] = 0xe5;
 }
 
+/* Draws the rest of the current frame into a frontend buffer (pitch in
+ * bytes) instead of pix, until systemDrawScreen presents it. Lines of
+ * the frame already drawn into pix are copied over. */
+void CPUSetFrameBuffer(void *buffer, unsigned pitch)
+{
+	pixel_t *out = (pixel_t *)buffer;
+	pitch /= sizeof(pixel_t);
+
+	frameJournalFlush();
+
+	pixel_t *src = frameBlend ? frameBlendOut : pix;
+	unsigned srcPitch = frameBlend ? frameBlendPitch : PIX_BUFFER_SCREEN_WIDTH;
+	int drawn = 0;
+	if(io_registers[REG_VCOUNT] < 160)
+		drawn = io_registers[REG_VCOUNT] + ((io_registers[REG_DISPSTAT] & 2) ? 1 : 0);
+	for(int y = 0; y < drawn; y++)
+		memcpy(&out[pitch * y], &src[srcPitch * y], 240 * sizeof(pixel_t));
+
+	if(frameBlend)
+	{
+		// the blended lines go there, pix still holds the frame as drawn
+		frameBlendOut = out;
+		frameBlendPitch = pitch;
+		return;
+	}
+
+	pixOut = out;
+	pixPitch = pitch;
+
+	// pix no longer holds the last frame
+	lineReuseReset();
+}
+
+static bool cpuHeadless = false;
+
+/* Headless runs the machine as usual but draws no line and mixes no
+ * sample; pix keeps the last frame drawn. Leaving it redraws from
+ * scratch. */
+void CPUSetHeadless(bool headless)
+{
+	if(headless == cpuHeadless)
+		return;
+
+	frameJournalFlush();
+	cpuHeadless = headless;
+	soundSetHeadless(headless);
+
+	if(headless)
+		dirtyDeferred = false;	// nothing replays the writes
+	else
+	{
+		dirtyMarkAll();
+		frameJournalReload();
+		lineReuseReset();
+	}
+}
+
+void CPUSetColorCorrection(bool enable)
+{
+	if(enable == colorCorrection)
+		return;
+
+	frameJournalFlush();
+	colorCorrection = enable;
+	colorLUTBuild();
+
+	// converted palette entries and lines kept from the last frame
+	dirtyMarkAll();
+	lineReuseReset();
+}
+
+/* Interframe blending: the frame that goes out is the average of the
+ * last two, which hides the flicker some games use for transparency. */
+void CPUSetFrameBlend(bool enable)
+{
+	if(enable == frameBlend)
+		return;
+
+	frameJournalFlush();
+
+	if(enable)
+	{
+		if(frameBlendBuffer == NULL)
+			frameBlendBuffer = (pixel_t *)calloc(PIX_BUFFER_SCREEN_WIDTH * 160, sizeof(pixel_t));
+		if(frameBlendBuffer == NULL)
+			return;
+		// a frontend buffer this frame now takes the blended lines
+		frameBlendOut = pixOut != pix ? pixOut : frameBlendBuffer;
+		frameBlendPitch = pixPitch;
+		pixOut = pix;
+		pixPitch = PIX_BUFFER_SCREEN_WIDTH;
+	}
+	else if(frameBlendOut != frameBlendBuffer)
+	{
+		pixOut = frameBlendOut;
+		pixPitch = frameBlendPitch;
+	}
+
+	frameBlend = enable;
+	lineReuseReset();
+}
+
+/* Fills bands with up to max (first line, line count) pairs covering
+ * the lines of the frame just completed that differ from the frame
+ * before it, for systemDrawScreen() to pass on only those. Returns the
+ * number of pairs; once max is reached the last one is stretched over
+ * the rest. A frame drawn into a frontend buffer is all one band. */
+unsigned CPUFrameDirtyBands(unsigned *bands, unsigned max)
+{
+	bool full = lineReuseFull || pixOut != (frameBlend ? frameBlendBuffer : pix);
+	unsigned n = 0;
+
+	if(!max)
+		return 0;
+
+	for(unsigned y = 0; y < 160; y++)
+	{
+		if(!full && !(lineReuseChangedBits(y >> 5) & (1 << (y & 31))))
+			continue;
+
+		if(n && bands[(n << 1) - 2] + bands[(n << 1) - 1] == y)
+			bands[(n << 1) - 1]++;
+		else if(n < max)
+		{
+			bands[n << 1] = y;
+			bands[(n << 1) + 1] = 1;
+			n++;
+		}
+		else
+			bands[(n << 1) - 1] = y + 1 - bands[(n << 1) - 2];
+	}
+	return n;
+}
+
+/* False when every line of the frame just completed came out as it was
+ * in pix, so the frontend can show the previous frame again. */
+bool CPUFrameChanged(void)
+{
+	if(lineReuseFull || pixOut != (frameBlend ? frameBlendBuffer : pix))
+		return true;
+	for(unsigned i = 0; i < (sizeof(lineReuseChanged) / sizeof(lineReuseChanged[0])); i++)
+		if(lineReuseChangedBits(i))
+			return true;
+	return false;
+}
+
 void CPULoop (void)
 {
 	bus.busPrefetchCount = 0;
@@ -3415,7 +3835,19 @@ updateLoop:
 							UPDATE_REG(0x202, io_registers[REG_IF]);
 						}
 						CPUCheckDMA(1, 0x0f);
+						frameJournalFlush();
+						if(frameBlend)
+						{
+							// the blended frame is the one that goes out
+							pixOut = frameBlendOut;
+							pixPitch = frameBlendPitch;
+						}
 						systemDrawScreen();
+						lineReuseFull = false;
+						pixOut = pix;
+						pixPitch = PIX_BUFFER_SCREEN_WIDTH;
+						frameBlendOut = frameBlendBuffer;
+						frameBlendPitch = PIX_BUFFER_SCREEN_WIDTH;
 					}
 
 					UPDATE_REG(0x04, io_registers[REG_DISPSTAT]);
@@ -3423,21 +3855,8 @@ updateLoop:
 				}
 				else
 				{
-					bool draw_objwin = (graphics.layerEnable & 0x9000) == 0x9000;
-					bool draw_sprites = graphics.layerEnable & 0x1000;
-					memset(line[4], -1, 240 * sizeof(u32));	// erase all sprites
-
-					if(draw_sprites)
-						gfxDrawSprites();
-
-					if(render_line_all_enabled)
-					{
-						memset(line[5], -1, 240 * sizeof(u32));	// erase all OBJ Win 
-						if(draw_objwin)
-							gfxDrawOBJWin();
-					}
-
-					(*renderLine)();
+					if(!cpuHeadless)
+						frameJournalLine();
 
 					// entering H-Blank
 					io_registers[REG_DISPSTAT] |= 2;
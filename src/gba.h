@@ -113,6 +113,13 @@ extern void CPUUpdateRegister(uint32_t, uint16_t);
 extern void CPUInit(const char *,bool);
 extern void CPUReset (void);
 extern void CPULoop(void);
+extern void CPUSetFrameBuffer(void *buffer, unsigned pitch);
+extern void CPUSetDeferredRender(bool enable);
+extern bool CPUFrameChanged(void);
+extern unsigned CPUFrameDirtyBands(unsigned *bands, unsigned max);
+extern void CPUSetHeadless(bool headless);
+extern void CPUSetColorCorrection(bool enable);
+extern void CPUSetFrameBlend(bool enable);
 extern void CPUCheckDMA(int,int);
 
 #endif // GBA_H
@@ -699,6 +699,9 @@ static void BIOS_RegisterRamReset(u32 flags)
 
 	if(flags)
 	{
+		if(flags & 0x1c)
+			frameJournalFlush();
+
 		if(flags & 0x01)
 			memset(workRAM, 0, 0x40000);		// clear work RAM
 
@@ -706,13 +709,22 @@ static void BIOS_RegisterRamReset(u32 flags)
 			memset(internalRAM, 0, 0x7e00);		// don't clear 0x7e00-0x7fff, clear internal RAM
 
 		if(flags & 0x04)
+		{
 			memset(graphics.paletteRAM, 0, 0x400);	// clear palette RAM
+			dirtyMarkPalette(0, 0x400);
+		}
 
 		if(flags & 0x08)
+		{
 			memset(vram, 0, 0x18000);		// clear VRAM
+			dirtyMarkVram(0, 0x18000);
+		}
 
 		if(flags & 0x10)
+		{
 			memset(oam, 0, 0x400);			// clean OAM
+			dirtyMarkOam(0, 0x400);
+		}
 
 		if(flags & 0x80) {
 			int i;
@@ -0,0 +1,476 @@
+/*============================================================
+	GBA LINE COMPOSITING
+============================================================ */
+
+/* The per-pixel layer selection, windows and colour special effects of
+ * the modeN renderers. Everything that is fixed for a line - the BGs of
+ * the mode, whether windows are on, the BLDMOD effect and whether any
+ * semi-transparent OBJ was drawn - is a template argument, so each
+ * instance only keeps the work its case needs. gfxCompose() picks the
+ * instance once per line. */
+
+static u8 gfxLineMask[240];
+static u32 gfxLineSkip[8];		/* pixels that can only show the plain backdrop */
+
+/* window coverage is kept as 240-bit masks, bit x for pixel x */
+static INLINE void gfxSetSpan(u32 *mask, int first, int end)
+{
+	if(end > 240)
+		end = 240;
+	if(first >= end)
+		return;
+
+	int w0 = first >> 5;
+	int w1 = (end - 1) >> 5;
+	u32 head = ~0u << (first & 31);
+	u32 tail = ~0u >> (31 - ((end - 1) & 31));
+
+	if(w0 == w1)
+	{
+		mask[w0] |= head & tail;
+		return;
+	}
+	mask[w0] |= head;
+	for(int w = w0 + 1; w < w1; w++)
+		mask[w] = ~0u;
+	mask[w1] |= tail;
+}
+
+/* WINxH: [x0,x1), wrapping around the right edge when x0 > x1 */
+static void gfxWindowSpan(u32 *mask, int x0, int x1)
+{
+	memset(mask, 0, 8 * sizeof(u32));
+	if(x0 <= x1)
+		gfxSetSpan(mask, x0, x1);
+	else
+	{
+		gfxSetSpan(mask, x0, 240);
+		gfxSetSpan(mask, 0, x1);
+	}
+}
+
+/* pixels inside the OBJ window (bit 31 of line[5] clear) */
+static void gfxOBJWindowBits(u32 *bits)
+{
+	memset(bits, 0, 8 * sizeof(u32));
+#ifdef GFX_SIMD
+	for(int x = 0; x < 240; x += VEC32_LANES)
+		bits[x >> 5] |= (u32)vec32_signbits(vec32_load(&line[5][x])) << (x & 31);
+	for(int w = 0; w < 8; w++)
+		bits[w] = ~bits[w];
+#else
+	for(int x = 0; x < 240; x++)
+		if(!(line[5][x] & 0x80000000))
+			bits[x >> 5] |= 1u << (x & 31);
+#endif
+	bits[7] &= 0xFFFF;
+}
+
+/* per-pixel WININ/WINOUT layer mask of the current line; a region whose
+ * mask lets none of the layers in 'used' through and has no effect on the
+ * backdrop marks its pixels in gfxLineSkip */
+static void gfxDrawWindowMask(u32 used, bool fxBackdrop)
+{
+	u32 y = gfxView.io[REG_VCOUNT];
+	bool inWindow0 = false;
+	bool inWindow1 = false;
+
+	if(gfxView.layerEnable & 0x2000) {
+		uint8_t v0 = gfxView.io[REG_WIN0V] >> 8;
+		uint8_t v1 = gfxView.io[REG_WIN0V] & 255;
+		inWindow0 = ((v0 == v1) && (v0 >= 0xe8));
+		if(v1 >= v0)
+			inWindow0 |= (y >= v0 && y < v1);
+		else
+			inWindow0 |= (y >= v0 || y < v1);
+	}
+	if(gfxView.layerEnable & 0x4000) {
+		uint8_t v0 = gfxView.io[REG_WIN1V] >> 8;
+		uint8_t v1 = gfxView.io[REG_WIN1V] & 255;
+		inWindow1 = ((v0 == v1) && (v0 >= 0xe8));
+		if(v1 >= v0)
+			inWindow1 |= (y >= v0 && y < v1);
+		else
+			inWindow1 |= (y >= v0 || y < v1);
+	}
+
+	/* win0, win1, OBJ window, outside */
+	uint8_t masks[4];
+	masks[0] = gfxView.io[REG_WININ] & 0xFF;
+	masks[1] = gfxView.io[REG_WININ] >> 8;
+	masks[2] = gfxView.io[REG_WINOUT] >> 8;
+	masks[3] = gfxView.io[REG_WINOUT] & 0xFF;
+
+	u32 skipRegion = 0;
+	for(int r = 0; r < 4; r++)
+		if(!(masks[r] & used) && !(fxBackdrop && (masks[r] & 32)))
+			skipRegion |= 1 << r;
+
+	u32 objWin[8];
+	gfxOBJWindowBits(objWin);
+
+	for(int w = 0; w < 8; w++)
+	{
+		u32 valid = (w == 7) ? 0xFFFF : ~0u;
+		u32 bits[4];
+		bits[0] = inWindow0 ? gfxView.inWin[0][w] : 0;
+		bits[1] = inWindow1 ? gfxView.inWin[1][w] & ~bits[0] : 0;
+		bits[2] = objWin[w] & ~(bits[0] | bits[1]);
+		bits[3] = valid & ~(bits[0] | bits[1] | bits[2]);
+
+		u32 skip = 0;
+		int whole = -1;
+		for(int r = 0; r < 4; r++)
+		{
+			if(skipRegion & (1 << r))
+				skip |= bits[r];
+			if(bits[r] == valid)
+				whole = r;
+		}
+		gfxLineSkip[w] = skip;
+
+		u8 *out = &gfxLineMask[w << 5];
+		int n = (w == 7) ? 16 : 32;
+		if(whole >= 0)
+		{
+			memset(out, masks[whole], n);
+			continue;
+		}
+		for(int i = 0; i < n; i++)
+		{
+			u32 bit = 1u << i;
+			int r = (bits[0] & bit) ? 0 : (bits[1] & bit) ? 1 : (bits[2] & bit) ? 2 : 3;
+			out[i] = masks[r];
+		}
+	}
+}
+
+/* front-most of the backdrop and line[n] for each bit n set in both
+ * LAYERS and layers; the lowest priority byte wins, earlier layers win
+ * ties */
+#define GFX_COMPOSE_PICK(n) \
+	if((LAYERS & (1 << n)) && (layers & (1 << n)) && (line[n][x] >> 24) < (color >> 24)) \
+	{ \
+		color = line[n][x]; \
+		top = 1 << n; \
+	}
+
+template<int LAYERS>
+static INLINE u32 gfxComposePick(int x, u32 layers, u32 backdrop, u32 &top)
+{
+	u32 color = backdrop;
+	top = 0x20;
+	GFX_COMPOSE_PICK(0)
+	GFX_COMPOSE_PICK(1)
+	GFX_COMPOSE_PICK(2)
+	GFX_COMPOSE_PICK(3)
+	GFX_COMPOSE_PICK(4)
+	return color;
+}
+
+#undef GFX_COMPOSE_PICK
+
+/* colour special effect applied to a pixel after layer selection */
+#define GFX_BLEND_NONE		0
+#define GFX_BLEND_ALPHA		1
+#define GFX_BLEND_LIGHTEN	2
+#define GFX_BLEND_DARKEN	3
+
+#ifdef GFX_SIMD
+
+/* Picks the front-most of the backdrop, the BGs in layers (bit n for
+ * line[n]) and, when obj is set, OBJ, exactly like the scalar loops:
+ * strictly lower priority byte wins, earlier layers win ties. */
+static INLINE vec32 gfxSelectLayers(int x, u32 backdrop, int layers, bool obj, vec32 &top)
+{
+	vec32 color = vec32_set1(backdrop);
+	vec32 prio = vec32_set1(backdrop >> 24);
+	top = vec32_set1(0x20);
+
+	for(int i = 0; i < 5; i++)
+	{
+		if(i == 4 ? !obj : !(layers & (1 << i)))
+			continue;
+		vec32 v = vec32_load(&line[i][x]);
+		vec32 p = vec32_srl(v, 24);
+		vec32 m = vec32_lt(p, prio);
+		prio = vec32_select(m, p, prio);
+		color = vec32_select(m, v, color);
+		top = vec32_select(m, vec32_set1(1 << i), top);
+	}
+	return color;
+}
+
+/* GFX_ALPHA_BLEND, gfxIncreaseBrightness and gfxDecreaseBrightness on the
+ * lanes op selects, per 5-bit channel with the sum clamped to 31. Only
+ * the low 15 bits of the result are kept, as CONVERT_COLOR does. */
+static INLINE vec32 gfxBlendBlock(vec32 color, vec32 back, vec32 op, vec32 ca, vec32 cb, vec32 cy)
+{
+	vec32 zero = vec32_set1(0);
+	if(!vec32_any(vec32_lt(zero, op)))
+		return color;
+
+	vec32 m = vec32_set1(0x1F);
+	vec32 r = vec32_and(color, m);
+	vec32 g = vec32_and(vec32_srl(color, 5), m);
+	vec32 b = vec32_and(vec32_srl(color, 10), m);
+	vec32 out = color;
+
+	vec32 sel = vec32_eq(op, vec32_set1(GFX_BLEND_ALPHA));
+	if(vec32_any(sel))
+	{
+		vec32 r2 = vec32_and(back, m);
+		vec32 g2 = vec32_and(vec32_srl(back, 5), m);
+		vec32 b2 = vec32_and(vec32_srl(back, 10), m);
+		r2 = vec32_min16(vec32_add(vec32_srl(vec32_mul16(r, ca), 4), vec32_srl(vec32_mul16(r2, cb), 4)), m);
+		g2 = vec32_min16(vec32_add(vec32_srl(vec32_mul16(g, ca), 4), vec32_srl(vec32_mul16(g2, cb), 4)), m);
+		b2 = vec32_min16(vec32_add(vec32_srl(vec32_mul16(b, ca), 4), vec32_srl(vec32_mul16(b2, cb), 4)), m);
+		out = vec32_select(sel, vec32_or(vec32_or(r2, vec32_sll(g2, 5)), vec32_sll(b2, 10)), out);
+	}
+
+	sel = vec32_eq(op, vec32_set1(GFX_BLEND_LIGHTEN));
+	if(vec32_any(sel))
+	{
+		vec32 r2 = vec32_add(r, vec32_srl(vec32_mul16(vec32_sub(m, r), cy), 4));
+		vec32 g2 = vec32_add(g, vec32_srl(vec32_mul16(vec32_sub(m, g), cy), 4));
+		vec32 b2 = vec32_add(b, vec32_srl(vec32_mul16(vec32_sub(m, b), cy), 4));
+		out = vec32_select(sel, vec32_or(vec32_or(r2, vec32_sll(g2, 5)), vec32_sll(b2, 10)), out);
+	}
+
+	sel = vec32_eq(op, vec32_set1(GFX_BLEND_DARKEN));
+	if(vec32_any(sel))
+	{
+		vec32 r2 = vec32_sub(r, vec32_srl(vec32_mul16(r, cy), 4));
+		vec32 g2 = vec32_sub(g, vec32_srl(vec32_mul16(g, cy), 4));
+		vec32 b2 = vec32_sub(b, vec32_srl(vec32_mul16(b, cy), 4));
+		out = vec32_select(sel, vec32_or(vec32_or(r2, vec32_sll(g2, 5)), vec32_sll(b2, 10)), out);
+	}
+
+	return out;
+}
+
+static INLINE void gfxStoreBlocks(pixel_t *lineMix, int x, vec32 a, vec32 b)
+{
+#ifdef FRONTEND_SUPPORTS_XRGB8888
+	vec32_store(&lineMix[x], vec32_convert_color(a));
+	vec32_store(&lineMix[x + VEC32_LANES], vec32_convert_color(b));
+#else
+	vec16_store(&lineMix[x], vec16_convert_color(a, b));
+#endif
+}
+
+/* converts a line whose effects were chosen by the scalar selection */
+static void gfxBlendLine(pixel_t *lineMix, const u32 *colors, const u32 *backs, const u32 *ops)
+{
+	vec32 ca = vec32_set1(coeff[gfxView.COLEV & 0x1F]);
+	vec32 cb = vec32_set1(coeff[(gfxView.COLEV >> 8) & 0x1F]);
+	vec32 cy = vec32_set1(coeff[gfxView.COLY & 0x1F]);
+
+	for(int x = 0; x < 240; x += 2 * VEC32_LANES)
+	{
+		int x2 = x + VEC32_LANES;
+		vec32 a = gfxBlendBlock(vec32_load(&colors[x]), vec32_load(&backs[x]), vec32_load(&ops[x]), ca, cb, cy);
+		vec32 b = gfxBlendBlock(vec32_load(&colors[x2]), vec32_load(&backs[x2]), vec32_load(&ops[x2]), ca, cb, cy);
+		gfxStoreBlocks(lineMix, x, a, b);
+	}
+}
+
+/* Top layer, semi-transparent OBJ detection, second layer and blend
+ * decision for modeNRenderLine (no windows, no colour effect selected). */
+static INLINE vec32 gfxCompositeBlock(int x, u32 backdrop, int layers)
+{
+	vec32 top, top2;
+	vec32 color = gfxSelectLayers(x, backdrop, layers, true, top);
+	vec32 semi = vec32_and(vec32_eq(top, vec32_set1(0x10)),
+			vec32_eq(vec32_and(color, vec32_set1(0x00010000)), vec32_set1(0x00010000)));
+
+	if(!vec32_any(semi))
+		return color;
+
+	vec32 back = gfxSelectLayers(x, backdrop, layers, false, top2);
+	vec32 blend = vec32_and(semi, vec32_lt(vec32_set1(0),
+				vec32_and(top2, vec32_set1((gfxView.BLDMOD >> 8) & 0x3F))));
+
+	/* the other semi-transparent pixels take the brightness effect */
+	int effect = (gfxView.BLDMOD >> 6) & 3;
+	vec32 op = vec32_set1(0);
+	if((gfxView.BLDMOD & 0x10) && effect >= 2)
+		op = vec32_select(semi, vec32_set1(effect), op);
+	op = vec32_select(blend, vec32_set1(GFX_BLEND_ALPHA), op);
+
+	return gfxBlendBlock(color, back, op, vec32_set1(coeff[gfxView.COLEV & 0x1F]),
+			vec32_set1(coeff[(gfxView.COLEV >> 8) & 0x1F]), vec32_set1(coeff[gfxView.COLY & 0x1F]));
+}
+
+static void gfxCompositeLine(pixel_t *lineMix, u32 backdrop, int layers)
+{
+	for(int x = 0; x < 240; x += 2 * VEC32_LANES)
+	{
+		vec32 a = gfxCompositeBlock(x, backdrop, layers);
+		vec32 b = gfxCompositeBlock(x + VEC32_LANES, backdrop, layers);
+		gfxStoreBlocks(lineMix, x, a, b);
+	}
+}
+
+#endif
+
+template<int LAYERS, bool WINDOW, int EFFECT, bool SEMI>
+static void gfxComposeLine(pixel_t *lineMix, u32 backdrop)
+{
+	u32 target1 = gfxView.BLDMOD & 0x3F;
+	u32 target2 = (gfxView.BLDMOD >> 8) & 0x3F;
+	int ca = coeff[gfxView.COLEV & 0x1F];
+	int cb = coeff[(gfxView.COLEV >> 8) & 0x1F];
+	int cy = coeff[gfxView.COLY & 0x1F];
+
+	pixel_t plain = CONVERT_COLOR(backdrop);
+
+#ifdef GFX_SIMD
+	/* with an effect possible, selection only records colour, second
+	 * colour and effect; gfxBlendLine applies and converts them */
+	const bool deferred = SEMI || EFFECT != 0;
+	u32 colors[240], backs[240], ops[240];
+#endif
+
+	for(int x = 0; x < 240; x++)
+	{
+		if(WINDOW && !(x & 31) && gfxLineSkip[x >> 5] == ((x == 224) ? 0xFFFF : ~0u))
+		{
+			int end = (x == 224) ? 240 : x + 32;
+			for(; x < end; x++)
+			{
+#ifdef GFX_SIMD
+				if(deferred)
+				{
+					colors[x] = backdrop;
+					backs[x] = backdrop;
+					ops[x] = GFX_BLEND_NONE;
+					continue;
+				}
+#endif
+				lineMix[x] = plain;
+			}
+			x--;
+			continue;
+		}
+
+		u32 mask = WINDOW ? gfxLineMask[x] : 0x3F;
+		u32 top, top2;
+		u32 color = gfxComposePick<LAYERS | 0x10>(x, mask, backdrop, top);
+		u32 back = color;
+		u32 op = GFX_BLEND_NONE;
+
+		if(SEMI && (color & 0x00010000))
+		{
+			// semi-transparent OBJ
+			back = gfxComposePick<LAYERS>(x, mask, backdrop, top2);
+			if(top2 & (gfxView.BLDMOD >> 8))
+			{
+				if(color < 0x80000000)
+					op = GFX_BLEND_ALPHA;
+			}
+			else if((gfxView.BLDMOD & top) && EFFECT >= 2)
+				op = EFFECT;
+		}
+		else if(EFFECT != 0 && (mask & 32) && (top & target1))
+		{
+			if(EFFECT == 1)
+			{
+				back = gfxComposePick<LAYERS | 0x10>(x, mask & ~top, backdrop, top2);
+				if((top2 & target2) && color < 0x80000000)
+					op = GFX_BLEND_ALPHA;
+			}
+			else
+				op = EFFECT;
+		}
+
+#ifdef GFX_SIMD
+		if(deferred)
+		{
+			colors[x] = color;
+			backs[x] = back;
+			ops[x] = op;
+			continue;
+		}
+#endif
+		switch(op)
+		{
+			case GFX_BLEND_ALPHA:
+				{
+					GFX_ALPHA_BLEND(color, back, ca, cb);
+				}
+				break;
+			case GFX_BLEND_LIGHTEN:
+				color = gfxIncreaseBrightness(color, cy);
+				break;
+			case GFX_BLEND_DARKEN:
+				color = gfxDecreaseBrightness(color, cy);
+				break;
+		}
+		lineMix[x] = CONVERT_COLOR(color);
+	}
+
+#ifdef GFX_SIMD
+	if(deferred)
+		gfxBlendLine(lineMix, colors, backs, ops);
+#endif
+}
+
+/* LAYERS: the BGs of the mode (bit n for line[n]); effect: BLDMOD bits 6-7,
+ * or 0 when the renderer has special effects off */
+template<int LAYERS, bool WINDOW>
+static void gfxCompose(pixel_t *lineMix, u32 backdrop, int effect)
+{
+	static void (* const compose[8])(pixel_t *, u32) =
+	{
+		gfxComposeLine<LAYERS, WINDOW, 0, false>, gfxComposeLine<LAYERS, WINDOW, 0, true>,
+		gfxComposeLine<LAYERS, WINDOW, 1, false>, gfxComposeLine<LAYERS, WINDOW, 1, true>,
+		gfxComposeLine<LAYERS, WINDOW, 2, false>, gfxComposeLine<LAYERS, WINDOW, 2, true>,
+		gfxComposeLine<LAYERS, WINDOW, 3, false>, gfxComposeLine<LAYERS, WINDOW, 3, true>
+	};
+
+	// nothing in front of the backdrop and no effect on it
+	if(!(gfxView.layerEnable & ((LAYERS << 8) | 0x1000)) && (effect == 0 || !(gfxView.BLDMOD & 0x20)))
+	{
+		gfxPaletteOutUpdate();
+		pixel_t color = gfxPaletteOut[0];
+		for(int x = 0; x < 240; x++)
+			lineMix[x] = color;
+		return;
+	}
+
+#ifdef GFX_SIMD
+	if(!WINDOW && effect == 0)
+	{
+		gfxCompositeLine(lineMix, backdrop, LAYERS);
+		return;
+	}
+#endif
+
+	if(WINDOW)
+		gfxDrawWindowMask((LAYERS | 0x10) & (gfxView.layerEnable >> 8), effect != 0 && (gfxView.BLDMOD & 0x20));
+
+	bool semi = gfxLineSemiOBJ && (gfxView.layerEnable & 0x1000);
+	compose[(effect << 1) | semi](lineMix, backdrop);
+}
+
+/* Interframe blending: out is the average of a line of the frame and
+ * the same line of the frame before, per channel and rounded down.
+ * Halving the XOR under PIXEL_AVG_MASK keeps each channel's bits from
+ * spilling into its neighbour, so whole words are done at once. */
+static void gfxBlendFrameLine(pixel_t *out, const pixel_t *cur, const pixel_t *prev)
+{
+	int x = 0;
+#ifdef GFX_SIMD
+	const int step = VEC32_LANES * 4 / sizeof(pixel_t);
+	vec32 mask = vec32_set1(PIXEL_AVG_MASK);
+	for(; x + step <= 240; x += step)
+	{
+		vec32 a = vec32_load(&cur[x]);
+		vec32 b = vec32_load(&prev[x]);
+		vec32_store(&out[x], vec32_add(vec32_and(a, b), vec32_srl(vec32_and(vec32_xor(a, b), mask), 1)));
+	}
+#endif
+	for(; x < 240; x++)
+		out[x] = (cur[x] & prev[x]) + (((cur[x] ^ prev[x]) & PIXEL_AVG_MASK) >> 1);
+}
@@ -0,0 +1,180 @@
+/*============================================================
+	GBA DIRTY TRACKING
+============================================================ */
+
+/* Consumers (caches, scanline reuse, ...) register a dirty_t and
+ * are told which VRAM blocks, OAM entries and palette entries changed
+ * value since they last cleared it. Writes that store the value already
+ * there are not reported. With no consumer registered the write paths
+ * only pay for the dirtyConsumerCount test. */
+
+#define DIRTY_VRAM_BLOCK_SHIFT	10				/* 1 KB blocks */
+#define DIRTY_VRAM_BLOCKS	(0x20000 >> DIRTY_VRAM_BLOCK_SHIFT)
+#define DIRTY_OAM_ENTRIES	128				/* 8 bytes each */
+#define DIRTY_PALETTE_ENTRIES	512
+#define DIRTY_MAX_CONSUMERS	8
+
+typedef struct
+{
+	u32 vram[DIRTY_VRAM_BLOCKS >> 5];
+	u32 oam[DIRTY_OAM_ENTRIES >> 5];
+	u32 palette[DIRTY_PALETTE_ENTRIES >> 5];
+} dirty_t;
+
+static dirty_t *dirtyConsumers[DIRTY_MAX_CONSUMERS];
+static int dirtyConsumerCount = 0;
+
+/* Set while gba_journal.inl holds lines back for deferred or threaded
+ * rendering: writes are logged instead of marked, and marked when the
+ * journal replays them between its lines. */
+#define DIRTY_KIND_VRAM		0
+#define DIRTY_KIND_OAM		1
+#define DIRTY_KIND_PALETTE	2
+
+static bool dirtyDeferred = false;
+static void frameJournalWrite(int kind, u32 address, u32 size);
+static void frameJournalFlush(void);
+static void frameJournalStop(void);
+
+static INLINE void dirtySetBits(u32 *bits, u32 first, u32 last)
+{
+	for(u32 i = first; i <= last; i++)
+		bits[i >> 5] |= 1 << (i & 31);
+}
+
+static INLINE bool dirtyTestBits(const u32 *bits, u32 first, u32 last)
+{
+	for(u32 i = first; i <= last; i++)
+		if(bits[i >> 5] & (1 << (i & 31)))
+			return true;
+	return false;
+}
+
+/* mark functions take a byte offset into vram, oam or paletteRAM */
+
+static INLINE void dirtyMarkKind(int kind, u32 address, u32 size)
+{
+	switch(kind)
+	{
+		case DIRTY_KIND_VRAM:
+			for(int i = 0; i < dirtyConsumerCount; i++)
+				dirtySetBits(dirtyConsumers[i]->vram, address >> DIRTY_VRAM_BLOCK_SHIFT,
+						(address + size - 1) >> DIRTY_VRAM_BLOCK_SHIFT);
+			break;
+		case DIRTY_KIND_OAM:
+			for(int i = 0; i < dirtyConsumerCount; i++)
+				dirtySetBits(dirtyConsumers[i]->oam, address >> 3, (address + size - 1) >> 3);
+			break;
+		default:
+			for(int i = 0; i < dirtyConsumerCount; i++)
+				dirtySetBits(dirtyConsumers[i]->palette, address >> 1, (address + size - 1) >> 1);
+			break;
+	}
+}
+
+static INLINE void dirtyMarkVram(u32 address, u32 size)
+{
+	if(dirtyDeferred)
+	{
+		frameJournalWrite(DIRTY_KIND_VRAM, address, size);
+		return;
+	}
+	dirtyMarkKind(DIRTY_KIND_VRAM, address, size);
+}
+
+static INLINE void dirtyMarkOam(u32 address, u32 size)
+{
+	if(dirtyDeferred)
+	{
+		frameJournalWrite(DIRTY_KIND_OAM, address, size);
+		return;
+	}
+	dirtyMarkKind(DIRTY_KIND_OAM, address, size);
+}
+
+static INLINE void dirtyMarkPalette(u32 address, u32 size)
+{
+	if(dirtyDeferred)
+	{
+		frameJournalWrite(DIRTY_KIND_PALETTE, address, size);
+		return;
+	}
+	dirtyMarkKind(DIRTY_KIND_PALETTE, address, size);
+}
+
+static INLINE void dirtyMarkAll(void)
+{
+	for(int i = 0; i < dirtyConsumerCount; i++)
+		memset(dirtyConsumers[i], 0xff, sizeof(dirty_t));
+}
+
+static INLINE void dirtyClear(dirty_t *d)
+{
+	memset(d, 0, sizeof(dirty_t));
+}
+
+/* read sets (line reuse) use the same layout; these fill one directly */
+static INLINE void dirtySetVram(dirty_t *d, u32 address, u32 size)
+{
+	dirtySetBits(d->vram, address >> DIRTY_VRAM_BLOCK_SHIFT, (address + size - 1) >> DIRTY_VRAM_BLOCK_SHIFT);
+}
+
+static INLINE bool dirtyIntersects(const dirty_t *a, const dirty_t *b)
+{
+	const u32 *x = (const u32 *)a;
+	const u32 *y = (const u32 *)b;
+	for(unsigned i = 0; i < sizeof(dirty_t) / sizeof(u32); i++)
+		if(x[i] & y[i])
+			return true;
+	return false;
+}
+
+/* A new consumer starts with everything dirty. Returns false when all
+ * DIRTY_MAX_CONSUMERS slots are taken: d is then never marked, and the
+ * consumer has to treat everything as dirty every time it looks. */
+static INLINE bool dirtyRegister(dirty_t *d)
+{
+	for(int i = 0; i < dirtyConsumerCount; i++)
+		if(dirtyConsumers[i] == d)
+			return true;
+	memset(d, 0xff, sizeof(dirty_t));
+	if(dirtyConsumerCount == DIRTY_MAX_CONSUMERS)
+		return false;
+	dirtyConsumers[dirtyConsumerCount++] = d;
+	return true;
+}
+
+static INLINE void dirtyUnregister(dirty_t *d)
+{
+	for(int i = 0; i < dirtyConsumerCount; i++)
+		if(dirtyConsumers[i] == d)
+		{
+			dirtyConsumers[i] = dirtyConsumers[--dirtyConsumerCount];
+			return;
+		}
+}
+
+static INLINE bool dirtyTestVram(const dirty_t *d, u32 address, u32 size)
+{
+	return dirtyTestBits(d->vram, address >> DIRTY_VRAM_BLOCK_SHIFT,
+			(address + size - 1) >> DIRTY_VRAM_BLOCK_SHIFT);
+}
+
+static INLINE bool dirtyTestOam(const dirty_t *d, u32 entry, u32 count)
+{
+	return dirtyTestBits(d->oam, entry, entry + count - 1);
+}
+
+static INLINE bool dirtyTestPalette(const dirty_t *d, u32 entry, u32 count)
+{
+	return dirtyTestBits(d->palette, entry, entry + count - 1);
+}
+
+static INLINE bool dirtyAny(const dirty_t *d)
+{
+	const u32 *bits = (const u32 *)d;
+	for(unsigned i = 0; i < sizeof(dirty_t) / sizeof(u32); i++)
+		if(bits[i])
+			return true;
+	return false;
+}
@@ -4,27 +4,204 @@
 static u32 map_widths[] = { 256, 512, 256, 512 };
 static u32 map_heights[] = { 256, 256, 512, 512 };
 
-static INLINE void gfxDrawTextScreen(bool process_layer0, bool process_layer1, bool process_layer2, bool process_layer3)
+/* Text BG tiles expanded to one palette index byte per pixel, indexed by
+ * the tile's VRAM address. 4bpp tiles are unpacked on first use; the
+ * horizontally flipped copy (4bpp and 8bpp) is built the first time the
+ * tile is drawn flipped. VRAM writes invalidate through tileCacheDirty. */
+
+#define TILE_CACHE_4BPP_TILES	(0x20000 >> 5)
+#define TILE_CACHE_8BPP_TILES	(0x20000 >> 6)
+#define TILE_CACHE_8BPP_OFFSET	(TILE_CACHE_4BPP_TILES * 128)
+#define TILE_CACHE_SIZE		(TILE_CACHE_8BPP_OFFSET + TILE_CACHE_8BPP_TILES * 64)
+
+static u8 *tileCache = NULL;		/* 4bpp [tile][flip][64], then 8bpp [tile][64] flipped */
+static u8 tileCacheValid4[TILE_CACHE_4BPP_TILES];	/* bit 0 plain, bit 1 flipped */
+static u8 tileCacheValid8[TILE_CACHE_8BPP_TILES];
+static dirty_t tileCacheDirty;
+static bool tileCacheTracked = false;	/* tileCacheDirty got a consumer slot */
+static dirty_t gfxLineReads;		/* VRAM read by the text BGs this line, for line reuse */
+
+static INLINE void tileCacheUpdate(void)
+{
+	if(!tileCacheTracked)
+		memset(&tileCacheDirty, 0xff, sizeof(dirty_t));
+	for(int w = 0; w < (DIRTY_VRAM_BLOCKS >> 5); w++)
+	{
+		u32 bits = tileCacheDirty.vram[w];
+		if(!bits)
+			continue;
+		tileCacheDirty.vram[w] = 0;
+		for(int b = 0; b < 32; b++)
+		{
+			if(!(bits & (1 << b)))
+				continue;
+			int block = (w << 5) + b;
+			memset(&tileCacheValid4[block << (DIRTY_VRAM_BLOCK_SHIFT - 5)], 0, 1 << (DIRTY_VRAM_BLOCK_SHIFT - 5));
+			memset(&tileCacheValid8[block << (DIRTY_VRAM_BLOCK_SHIFT - 6)], 0, 1 << (DIRTY_VRAM_BLOCK_SHIFT - 6));
+		}
+	}
+}
+
+static INLINE const u8 * tileCacheRow4(u32 address, int tileY, int flip)
+{
+	u32 tile = address >> 5;
+	u8 *t = &tileCache[(tile << 7) + (flip << 6)];
+	if(!(tileCacheValid4[tile] & (1 << flip)))
+	{
+		const u8 *src = &gfxVram[address];
+		int mirror = flip ? 7 : 0;
+		for(int i = 0; i < 64; i++)
+			t[i ^ mirror] = (i & 1) ? (src[i >> 1] >> 4) : (src[i >> 1] & 0x0F);
+		tileCacheValid4[tile] |= 1 << flip;
+	}
+	return t + (tileY << 3);
+}
+
+static INLINE const u8 * tileCacheRow8(u32 address, int tileY, int flip)
+{
+	if(!flip)
+		return &gfxVram[address + (tileY << 3)];
+
+	u32 tile = address >> 6;
+	u8 *t = &tileCache[TILE_CACHE_8BPP_OFFSET + (tile << 6)];
+	if(!tileCacheValid8[tile])
+	{
+		const u8 *src = &gfxVram[address];
+		for(int i = 0; i < 64; i++)
+			t[i ^ 7] = src[i];
+		tileCacheValid8[tile] = 1;
+	}
+	return t + (tileY << 3);
+}
+
+/* The 512 palette entries already in the frontend pixel format, for
+ * pixels that go out unblended. Entries written since the last line are
+ * converted again through gfxPaletteOutDirty. */
+
+static pixel_t gfxPaletteOut[DIRTY_PALETTE_ENTRIES];
+static dirty_t gfxPaletteOutDirty;
+static bool gfxPaletteOutTracked = false;
+
+static INLINE void gfxPaletteOutUpdate(void)
+{
+	u16 *palette = (u16 *)gfxPaletteRAM;
+	if(!gfxPaletteOutTracked)
+		memset(&gfxPaletteOutDirty, 0xff, sizeof(dirty_t));
+	for(int w = 0; w < (DIRTY_PALETTE_ENTRIES >> 5); w++)
+	{
+		u32 bits = gfxPaletteOutDirty.palette[w];
+		if(!bits)
+			continue;
+		gfxPaletteOutDirty.palette[w] = 0;
+		for(int b = 0; b < 32; b++)
+		{
+			if(!(bits & (1 << b)))
+				continue;
+			u32 color = READ16LE(&palette[(w << 5) + b]);
+			gfxPaletteOut[(w << 5) + b] = CONVERT_COLOR(color);
+		}
+	}
+}
+
+/* Stores pixel over line[x..end). Vector stores may run on into the
+ * next block, which is drawn after this one. */
+static INLINE void gfxMosaicFill(u32 *line, u32 x, u32 end, u32 pixel)
+{
+#ifdef GFX_SIMD
+	vec32 v = vec32_set1(pixel);
+	for(; x < end && x + VEC32_LANES <= 240u; x += VEC32_LANES)
+		vec32_store(&line[x], v);
+#endif
+	for(; x < end; x++)
+		line[x] = pixel;
+}
+
+/* A text BG line under horizontal mosaic shows the first pixel of each
+ * mosaicX wide block, so only those are fetched. Returns whether the
+ * line came out fully opaque. */
+static bool gfxDrawTextMosaic(u32 *line, const u16 *screenBase, int yshift, int xxx, int yyy,
+u32 sizeX, u32 charOffset, int eightBit, u32 prio, u32 mosaicX)
+{
+	u16 *palette = (u16 *)gfxPaletteRAM;
+	bool opaque = true;
+	for(u32 x = 0; x < 240u; x += mosaicX)
+	{
+		u32 mx = (xxx + x) & (sizeX - 1);
+		u16 data = READ16LE(screenBase + ((mx >> 8) << 10) + ((mx & 255) >> 3) + yshift);
+
+		int tile = data & 0x3FF;
+		int tileY = yyy & 7;
+		int flip = (data & 0x0400) ? 1 : 0;
+
+		if(data & 0x0800)
+			tileY = 7 - tileY;
+
+		u32 tileAddress = eightBit ? charOffset + (tile<<6) : charOffset + (tile<<5);
+		gfxLineReads.vram[tileAddress >> (DIRTY_VRAM_BLOCK_SHIFT + 5)] |= 1 << ((tileAddress >> DIRTY_VRAM_BLOCK_SHIFT) & 31);
+
+		u8 color;
+		int pal = 0;
+		if(eightBit)
+			color = tileCacheRow8(tileAddress, tileY, flip)[mx & 7];
+		else
+		{
+			color = tileCacheRow4(tileAddress, tileY, flip)[mx & 7];
+			pal = (data>>8) & 0xF0;
+		}
+
+		u32 end = x + mosaicX;
+		if(end > 240u)
+			end = 240u;
+		gfxMosaicFill(line, x, end, color ? (READ16LE(&palette[pal + color])|prio): 0x80000000);
+		opaque &= (color != 0);
+	}
+	return opaque;
+}
+
+/* Layers are drawn front to back. With cull set (no windows, no alpha
+ * blending) a layer behind one that came out fully opaque on this line
+ * cannot show through anywhere, so it is cleared instead of drawn. */
+static INLINE void gfxDrawTextScreen(bool process_layer0, bool process_layer1, bool process_layer2, bool process_layer3, bool cull)
 {
 	bool	process_layers[4] = {process_layer0, process_layer1, process_layer2, process_layer3};
-	u16	control_layers[4] = {io_registers[REG_BG0CNT], io_registers[REG_BG1CNT], io_registers[REG_BG2CNT], io_registers[REG_BG3CNT]};
-	u16	hofs_layers[4]	  = {io_registers[REG_BG0HOFS], io_registers[REG_BG1HOFS], io_registers[REG_BG2HOFS], io_registers[REG_BG3HOFS]};
-	u16	vofs_layers[4]	  = {io_registers[REG_BG0VOFS], io_registers[REG_BG1VOFS], io_registers[REG_BG2VOFS], io_registers[REG_BG3VOFS]};
+	u16	control_layers[4] = {gfxView.io[REG_BG0CNT], gfxView.io[REG_BG1CNT], gfxView.io[REG_BG2CNT], gfxView.io[REG_BG3CNT]};
+	u16	hofs_layers[4]	  = {gfxView.io[REG_BG0HOFS], gfxView.io[REG_BG1HOFS], gfxView.io[REG_BG2HOFS], gfxView.io[REG_BG3HOFS]};
+	u16	vofs_layers[4]	  = {gfxView.io[REG_BG0VOFS], gfxView.io[REG_BG1VOFS], gfxView.io[REG_BG2VOFS], gfxView.io[REG_BG3VOFS]};
 	u32 *	line_layers[4]	  = {line[0], line[1], line[2], line[3]};
-	
-	for(int i = 0; i < 4; i++)
+
+	tileCacheUpdate();
+
+	/* priority order; the lower BG number wins a tie */
+	int order[4] = {0, 1, 2, 3};
+	for(int n = 1; n < 4; n++)
+		for(int k = n; k > 0 && (control_layers[order[k]] & 3) < (control_layers[order[k - 1]] & 3); k--)
+		{
+			int t = order[k];
+			order[k] = order[k - 1];
+			order[k - 1] = t;
+		}
+
+	bool covered = false;
+	for(int n = 0; n < 4; n++)
 	{
+		int i = order[n];
 		if(!process_layers[i])
 			continue;
 
+		if(covered)
+		{
+			memset(line_layers[i], -1, 240 * sizeof(u32));
+			continue;
+		}
+
 		u16 control	= control_layers[i];
 		u16 hofs	= hofs_layers[i];
 		u16 vofs	= vofs_layers[i];
 		u32 * line	= line_layers[i];
 
-		u16 *palette = (u16 *)graphics.paletteRAM;
-		u8 *charBase = &vram[((control >> 2) & 0x03) << 14];
-		u16 *screenBase = (u16 *)&vram[((control >> 8) & 0x1f) << 11];
+		u16 *palette = (u16 *)gfxPaletteRAM;
+		u32 charOffset = ((control >> 2) & 0x03) << 14;
+		u16 *screenBase = (u16 *)&gfxVram[((control >> 8) & 0x1f) << 11];
 		u32 prio = ((control & 3)<<25) + 0x1000000;
 
 		u32 map_size = (control >> 14) & 3;
@@ -35,15 +212,15 @@ static INLINE void gfxDrawTextScreen(bool process_layer0, bool process_layer1, b
 		int maskY = sizeY-1;
 
 		int xxx = hofs & maskX;
-		int yyy = (vofs + io_registers[REG_VCOUNT]) & maskY;
-		int mosaicX = (MOSAIC & 0x000F)+1;
-		int mosaicY = ((MOSAIC & 0x00F0)>>4)+1;
+		int yyy = (vofs + gfxView.io[REG_VCOUNT]) & maskY;
+		int mosaicX = (gfxView.MOSAIC & 0x000F)+1;
+		int mosaicY = ((gfxView.MOSAIC & 0x00F0)>>4)+1;
 
 		bool mosaicOn = (control & 0x40) ? true : false;
 
-		if(mosaicOn && ((io_registers[REG_VCOUNT] % mosaicY) != 0))
+		if(mosaicOn && ((gfxView.io[REG_VCOUNT] % mosaicY) != 0))
 		{
-			mosaicY = io_registers[REG_VCOUNT] - (io_registers[REG_VCOUNT] % mosaicY);
+			mosaicY = gfxView.io[REG_VCOUNT] - (gfxView.io[REG_VCOUNT] % mosaicY);
 			yyy = (vofs + mosaicY) & maskY;
 		}
 
@@ -57,108 +234,215 @@ static INLINE void gfxDrawTextScreen(bool process_layer0, bool process_layer1, b
 
 		int yshift = ((yyy>>3)<<5);
 		u16 *screenSource = screenBase + ((xxx>>8) << 10) + ((xxx & 255)>>3) + yshift;
-		if((control) & 0x80)
-		{
-			for(u32 x = 0; x < 240u; x++)
-			{
-				u16 data = READ16LE(screenSource);
 
-				int tile = data & 0x3FF;
-				int tileX = (xxx & 7);
-				int tileY = yyy & 7;
+		u32 mapRow = (u8 *)(screenBase + yshift) - gfxVram;
+		dirtySetVram(&gfxLineReads, mapRow, 64);
+		if(sizeX > 256)
+			dirtySetVram(&gfxLineReads, mapRow + 0x800, 64);
+		int eightBit = (control & 0x80) ? 1 : 0;
+		if(mosaicOn && (mosaicX > 1))
+		{
+			bool opaque = gfxDrawTextMosaic(line, screenBase, yshift, xxx, yyy,
+			sizeX, charOffset, eightBit, prio, mosaicX);
+			covered = cull && opaque;
+			continue;
+		}
 
-				if(tileX == 7)
-					++screenSource;
+		bool opaque = true;
+		u32 x = 0;
+		while(x < 240u)
+		{
+			u16 data = READ16LE(screenSource);
 
-				if(data & 0x0400)
-					tileX = 7 - tileX;
-				if(data & 0x0800)
-					tileY = 7 - tileY;
+			int tile = data & 0x3FF;
+			int tileX = (xxx & 7);
+			int tileY = yyy & 7;
+			int flip = (data & 0x0400) ? 1 : 0;
 
-				u8 color = charBase[(tile<<6)  + (tileY<<3) + tileX];
+			if(data & 0x0800)
+				tileY = 7 - tileY;
 
-				line[x] = color ? (READ16LE(&palette[color]) | prio): 0x80000000;
+			u32 tileAddress = eightBit ? charOffset + (tile<<6) : charOffset + (tile<<5);
+			gfxLineReads.vram[tileAddress >> (DIRTY_VRAM_BLOCK_SHIFT + 5)] |= 1 << ((tileAddress >> DIRTY_VRAM_BLOCK_SHIFT) & 31);
 
-				if(++xxx == 256)
-				{
-					screenSource = screenBase + yshift;
-					if(sizeX > 256)
-						screenSource += 0x400;
-					else
-						xxx = 0;
-				}
-				else if(xxx >= sizeX)
-				{
-					xxx = 0;
-					screenSource = screenBase + yshift;
-				}
+			const u8 *row;
+			int pal;
+			if(eightBit)
+			{
+				row = tileCacheRow8(tileAddress, tileY, flip);
+				pal = 0;
 			}
-		}
-		else
-		{ 
-			for(u32 x = 0; x < 240u; ++x)
+			else
 			{
-				u16 data = READ16LE(screenSource);
-
-				int tile = data & 0x3FF;
-				int tileX = (xxx & 7);
-				int tileY = yyy & 7;
-
-				if(tileX == 7)
-					++screenSource;
+				row = tileCacheRow4(tileAddress, tileY, flip);
+				pal = (data>>8) & 0xF0;
+			}
 
-				if(data & 0x0400)
-					tileX = 7 - tileX;
-				if(data & 0x0800)
-					tileY = 7 - tileY;
+			u32 count = 8 - tileX;
+			if(count > 240u - x)
+				count = 240u - x;
 
-				u8 color = charBase[(tile<<5) + (tileY<<2) + (tileX>>1)];
+			for(u32 i = 0; i < count; i++)
+			{
+				u8 color = row[tileX + i];
+				line[x + i] = color ? (READ16LE(&palette[pal + color])|prio): 0x80000000;
+				opaque &= (color != 0);
+			}
+			x += count;
 
-				(tileX & 1) ? color >>= 4 : color &= 0x0F;
+			if(tileX + count < 8)
+				break;
 
-				int pal = (data>>8) & 0xF0;
-				line[x] = color ? (READ16LE(&palette[pal + color])|prio): 0x80000000;
+			++screenSource;
+			xxx += count;
 
-				if(++xxx == 256)
-				{
-					screenSource = screenBase + yshift;
-					if(sizeX > 256)
-						screenSource += 0x400;
-					else
-						xxx = 0;
-				}
-				else if(xxx >= sizeX)
-				{
+			if(xxx == 256)
+			{
+				screenSource = screenBase + yshift;
+				if(sizeX > 256)
+					screenSource += 0x400;
+				else
 					xxx = 0;
-					screenSource = screenBase + yshift;
-				}
 			}
-		}
-		if(mosaicOn && (mosaicX > 1))
-		{
-			int m = 1;
-			for(u32 i = 0; i < 239u; ++i)
+			else if(xxx >= sizeX)
 			{
-				line[i+1] = line[i];
-				++m;
-				if(m == mosaicX)
-				{
-					m = 1;
-					++i;
-				}
+				xxx = 0;
+				screenSource = screenBase + yshift;
 			}
 		}
+		covered = cull && opaque;
 	}
 }
 
 static u32 map_sizes_rot[] = { 128, 256, 512, 1024 };
 
+/* Moves a rotation BG's internal reference point down one line, or
+ * reloads it from BGxX/BGxY after they were written and on line 0. */
+static INLINE void gfxAffineStep(int &currentX, int &currentY, int changed,
+u16 x_l, u16 x_h, u16 y_l, u16 y_h, int dmx, int dmy)
+{
+	if(gfxView.io[REG_VCOUNT] == 0)
+		changed = 3;
+
+	currentX += dmx;
+	currentY += dmy;
+
+	if(changed & 1)
+	{
+		currentX = (x_l) | ((x_h & 0x07FF)<<16);
+		if(x_h & 0x0800)
+			currentX |= 0xF8000000;
+	}
+
+	if(changed & 2)
+	{
+		currentY = (y_l) | ((y_h & 0x07FF)<<16);
+		if(y_h & 0x0800)
+			currentY |= 0xF8000000;
+	}
+}
+
+#ifdef GFX_SIMD
+/* Vector versions of the affine BG loops below: VEC32_LANES texture
+ * coordinates per step, out-of-range and transparent lanes masked to
+ * 0xFFFFFFFF. The scalar loops remain for mosaic and non-SIMD builds. */
+
+static INLINE void gfxAffineLanes(int realX, int realY, int dx, int dy, vec32 &xs, vec32 &ys)
+{
+	u32 lx[VEC32_LANES], ly[VEC32_LANES];
+	for(int i = 0; i < VEC32_LANES; i++)
+	{
+		lx[i] = (u32)realX + (u32)(i * dx);
+		ly[i] = (u32)realY + (u32)(i * dy);
+	}
+	xs = vec32_load(lx);
+	ys = vec32_load(ly);
+}
+
+static void gfxRotLineTiled(u32 *line, int realX, int realY, int dx, int dy, const u8 *charBase,
+const u8 *screenBase, const u16 *palette, u32 prio, u32 size, int yshift, bool wrap)
+{
+	vec32 xs, ys;
+	gfxAffineLanes(realX, realY, dx, dy, xs, ys);
+	vec32 stepX = vec32_set1(dx * VEC32_LANES);
+	vec32 stepY = vec32_set1(dy * VEC32_LANES);
+	vec32 mask = vec32_set1(size - 1);
+	vec32 vsize = vec32_set1(size);
+	vec32 seven = vec32_set1(7);
+	vec32 zero = vec32_set1(0);
+	vec32 none = vec32_set1(0xFFFFFFFF);
+
+	for(int x = 0; x < 240; x += VEC32_LANES)
+	{
+		vec32 xxx = vec32_srl(xs, 8);
+		vec32 yyy = vec32_srl(ys, 8);
+		vec32 in = wrap ? none : vec32_and(vec32_lt(xxx, vsize), vec32_lt(yyy, vsize));
+		xxx = vec32_and(xxx, mask);
+		yyy = vec32_and(yyy, mask);
+
+		vec32 tile = vec32_gather8(screenBase, vec32_add(vec32_srl(xxx, 3), vec32_sllv(vec32_srl(yyy, 3), yshift)));
+		vec32 color = vec32_gather8(charBase, vec32_add(vec32_sll(tile, 6),
+					vec32_or(vec32_sll(vec32_and(yyy, seven), 3), vec32_and(xxx, seven))));
+		in = vec32_select(vec32_eq(color, zero), zero, in);
+
+		vec32 c = vec32_or(vec32_gather16(palette, color), vec32_set1(prio));
+		vec32_store(&line[x], vec32_select(in, c, none));
+
+		xs = vec32_add(xs, stepX);
+		ys = vec32_add(ys, stepY);
+	}
+}
+
+/* modes 3/5 (direct colour) when palette is NULL, mode 4 otherwise */
+static void gfxRotLineBitmap(u32 *line, int realX, int realY, int dx, int dy, const void *screenBase,
+const u16 *palette, u32 prio, u32 sizeX, u32 sizeY)
+{
+	vec32 xs, ys;
+	gfxAffineLanes(realX, realY, dx, dy, xs, ys);
+	vec32 stepX = vec32_set1(dx * VEC32_LANES);
+	vec32 stepY = vec32_set1(dy * VEC32_LANES);
+	vec32 vsizeX = vec32_set1(sizeX);
+	vec32 vsizeY = vec32_set1(sizeY);
+	vec32 zero = vec32_set1(0);
+	vec32 none = vec32_set1(0xFFFFFFFF);
+
+	for(int x = 0; x < 240; x += VEC32_LANES)
+	{
+		vec32 xxx = vec32_srl(xs, 8);
+		vec32 yyy = vec32_srl(ys, 8);
+		vec32 in = vec32_and(vec32_lt(xxx, vsizeX), vec32_lt(yyy, vsizeY));
+		xxx = vec32_select(in, xxx, zero);
+		yyy = vec32_select(in, yyy, zero);
+
+		/* yyy * sizeX, sizeX being 240 or 160 */
+		vec32 row = (sizeX == 240) ? vec32_sub(vec32_sll(yyy, 8), vec32_sll(yyy, 4)) :
+			vec32_add(vec32_sll(yyy, 7), vec32_sll(yyy, 5));
+		vec32 offset = vec32_add(row, xxx);
+
+		vec32 c;
+		if(palette)
+		{
+			vec32 color = vec32_gather8((const u8 *)screenBase, offset);
+			in = vec32_select(vec32_eq(color, zero), zero, in);
+			c = vec32_gather16(palette, color);
+		}
+		else
+			c = vec32_gather16((const u16 *)screenBase, offset);
+
+		vec32_store(&line[x], vec32_select(in, vec32_or(c, vec32_set1(prio)), none));
+
+		xs = vec32_add(xs, stepX);
+		ys = vec32_add(ys, stepY);
+	}
+}
+#endif
+
 static INLINE void gfxDrawRotScreen(u16 control, u16 x_l, u16 x_h, u16 y_l, u16 y_h,
 u16 pa,  u16 pb, u16 pc,  u16 pd, int& currentX, int& currentY, int changed, u32 *line)
 {
-	u16 *palette = (u16 *)graphics.paletteRAM;
-	u8 *charBase = &vram[((control >> 2) & 0x03) << 14];
-	u8 *screenBase = (u8 *)&vram[((control >> 8) & 0x1f) << 11];
+	u16 *palette = (u16 *)gfxPaletteRAM;
+	u8 *charBase = &gfxVram[((control >> 2) & 0x03) << 14];
+	u8 *screenBase = (u8 *)&gfxVram[((control >> 8) & 0x1f) << 11];
 	int prio = ((control & 3) << 25) + 0x1000000;
 
 	u32 map_size = (control >> 14) & 3;
@@ -183,37 +467,27 @@ u16 pa,  u16 pb, u16 pc,  u16 pd, int& currentX, int& currentY, int changed, u32
 	if(pd & 0x8000)
 		dmy |= 0xFFFF8000;
 
-	if(io_registers[REG_VCOUNT] == 0)
-		changed = 3;
-
-	currentX += dmx;
-	currentY += dmy;
-
-	if(changed & 1)
-	{
-		currentX = (x_l) | ((x_h & 0x07FF)<<16);
-		if(x_h & 0x0800)
-			currentX |= 0xF8000000;
-	}
-
-	if(changed & 2)
-	{
-		currentY = (y_l) | ((y_h & 0x07FF)<<16);
-		if(y_h & 0x0800)
-			currentY |= 0xF8000000;
-	}
+	gfxAffineStep(currentX, currentY, changed, x_l, x_h, y_l, y_h, dmx, dmy);
 
 	int realX = currentX;
 	int realY = currentY;
 
 	if(control & 0x40)
 	{
-		int mosaicY = ((MOSAIC & 0xF0)>>4) + 1;
-		int y = (io_registers[REG_VCOUNT] % mosaicY);
+		int mosaicY = ((gfxView.MOSAIC & 0xF0)>>4) + 1;
+		int y = (gfxView.io[REG_VCOUNT] % mosaicY);
 		realX -= y*dmx;
 		realY -= y*dmy;
 	}
 
+#ifdef GFX_SIMD
+	if(!(control & 0x40))
+	{
+		gfxRotLineTiled(line, realX, realY, dx, dy, charBase, screenBase, palette, prio, sizeX, yshift, (control & 0x2000) != 0);
+		return;
+	}
+#endif
+
 	memset(line, -1, 240 * sizeof(u32));
 	if(control & 0x2000)
 	{
@@ -263,7 +537,7 @@ u16 pa,  u16 pb, u16 pc,  u16 pd, int& currentX, int& currentY, int changed, u32
 
 	if(control & 0x40)
 	{
-		int mosaicX = (MOSAIC & 0xF) + 1;
+		int mosaicX = (gfxView.MOSAIC & 0xF) + 1;
 		if(mosaicX > 1)
 		{
 			int m = 1;
@@ -282,58 +556,40 @@ u16 pa,  u16 pb, u16 pc,  u16 pd, int& currentX, int& currentY, int changed, u32
 
 static INLINE void gfxDrawRotScreen16Bit( int& currentX,  int& currentY, int changed)
 {
-	u16 *screenBase = (u16 *)&vram[0];
-	int prio = ((io_registers[REG_BG2CNT] & 3) << 25) + 0x1000000;
+	u16 *screenBase = (u16 *)&gfxVram[0];
+	int prio = ((gfxView.io[REG_BG2CNT] & 3) << 25) + 0x1000000;
 
 	u32 sizeX = 240;
 	u32 sizeY = 160;
 
-	int startX = (BG2X_L) | ((BG2X_H & 0x07FF)<<16);
-	if(BG2X_H & 0x0800)
+	int startX = (gfxView.BG2X_L) | ((gfxView.BG2X_H & 0x07FF)<<16);
+	if(gfxView.BG2X_H & 0x0800)
 		startX |= 0xF8000000;
-	int startY = (BG2Y_L) | ((BG2Y_H & 0x07FF)<<16);
-	if(BG2Y_H & 0x0800)
+	int startY = (gfxView.BG2Y_L) | ((gfxView.BG2Y_H & 0x07FF)<<16);
+	if(gfxView.BG2Y_H & 0x0800)
 		startY |= 0xF8000000;
 
-	int dx = io_registers[REG_BG2PA] & 0x7FFF;
-	if(io_registers[REG_BG2PA] & 0x8000)
+	int dx = gfxView.io[REG_BG2PA] & 0x7FFF;
+	if(gfxView.io[REG_BG2PA] & 0x8000)
 		dx |= 0xFFFF8000;
-	int dmx = io_registers[REG_BG2PB] & 0x7FFF;
-	if(io_registers[REG_BG2PB] & 0x8000)
+	int dmx = gfxView.io[REG_BG2PB] & 0x7FFF;
+	if(gfxView.io[REG_BG2PB] & 0x8000)
 		dmx |= 0xFFFF8000;
-	int dy = io_registers[REG_BG2PC] & 0x7FFF;
-	if(io_registers[REG_BG2PC] & 0x8000)
+	int dy = gfxView.io[REG_BG2PC] & 0x7FFF;
+	if(gfxView.io[REG_BG2PC] & 0x8000)
 		dy |= 0xFFFF8000;
-	int dmy = io_registers[REG_BG2PD] & 0x7FFF;
-	if(io_registers[REG_BG2PD] & 0x8000)
+	int dmy = gfxView.io[REG_BG2PD] & 0x7FFF;
+	if(gfxView.io[REG_BG2PD] & 0x8000)
 		dmy |= 0xFFFF8000;
 
-	if(io_registers[REG_VCOUNT] == 0)
-		changed = 3;
-
-	currentX += dmx;
-	currentY += dmy;
-
-	if(changed & 1)
-	{
-		currentX = (BG2X_L) | ((BG2X_H & 0x07FF)<<16);
-		if(BG2X_H & 0x0800)
-			currentX |= 0xF8000000;
-	}
-
-	if(changed & 2)
-	{
-		currentY = (BG2Y_L) | ((BG2Y_H & 0x07FF)<<16);
-		if(BG2Y_H & 0x0800)
-			currentY |= 0xF8000000;
-	}
+	gfxAffineStep(currentX, currentY, changed, gfxView.BG2X_L, gfxView.BG2X_H, gfxView.BG2Y_L, gfxView.BG2Y_H, dmx, dmy);
 
 	int realX = currentX;
 	int realY = currentY;
 
-	if(io_registers[REG_BG2CNT] & 0x40) {
-		int mosaicY = ((MOSAIC & 0xF0)>>4) + 1;
-		int y = (io_registers[REG_VCOUNT] % mosaicY);
+	if(gfxView.io[REG_BG2CNT] & 0x40) {
+		int mosaicY = ((gfxView.MOSAIC & 0xF0)>>4) + 1;
+		int y = (gfxView.io[REG_VCOUNT] % mosaicY);
 		realX -= y*dmx;
 		realY -= y*dmy;
 	}
@@ -341,6 +597,14 @@ static INLINE void gfxDrawRotScreen16Bit( int& currentX,  int& currentY, int cha
 	unsigned xxx = (realX >> 8);
 	unsigned yyy = (realY >> 8);
 
+#ifdef GFX_SIMD
+	if(!(gfxView.io[REG_BG2CNT] & 0x40))
+	{
+		gfxRotLineBitmap(line[2], realX, realY, dx, dy, screenBase, NULL, prio, sizeX, sizeY);
+		return;
+	}
+#endif
+
 	memset(line[2], -1, 240 * sizeof(u32));
 	for(u32 x = 0; x < 240u; ++x)
 	{
@@ -354,8 +618,8 @@ static INLINE void gfxDrawRotScreen16Bit( int& currentX,  int& currentY, int cha
 		yyy = (realY >> 8);
 	}
 
-	if(io_registers[REG_BG2CNT] & 0x40) {
-		int mosaicX = (MOSAIC & 0xF) + 1;
+	if(gfxView.io[REG_BG2CNT] & 0x40) {
+		int mosaicX = (gfxView.MOSAIC & 0xF) + 1;
 		if(mosaicX > 1) {
 			int m = 1;
 			for(u32 i = 0; i < 239u; ++i)
@@ -373,58 +637,40 @@ static INLINE void gfxDrawRotScreen16Bit( int& currentX,  int& currentY, int cha
 
 static INLINE void gfxDrawRotScreen256(int &currentX, int& currentY, int changed)
 {
-	u16 *palette = (u16 *)graphics.paletteRAM;
-	u8 *screenBase = (io_registers[REG_DISPCNT] & 0x0010) ? &vram[0xA000] : &vram[0x0000];
-	int prio = ((io_registers[REG_BG2CNT] & 3) << 25) + 0x1000000;
+	u16 *palette = (u16 *)gfxPaletteRAM;
+	u8 *screenBase = (gfxView.io[REG_DISPCNT] & 0x0010) ? &gfxVram[0xA000] : &gfxVram[0x0000];
+	int prio = ((gfxView.io[REG_BG2CNT] & 3) << 25) + 0x1000000;
 	u32 sizeX = 240;
 	u32 sizeY = 160;
 
-	int startX = (BG2X_L) | ((BG2X_H & 0x07FF)<<16);
-	if(BG2X_H & 0x0800)
+	int startX = (gfxView.BG2X_L) | ((gfxView.BG2X_H & 0x07FF)<<16);
+	if(gfxView.BG2X_H & 0x0800)
 		startX |= 0xF8000000;
-	int startY = (BG2Y_L) | ((BG2Y_H & 0x07FF)<<16);
-	if(BG2Y_H & 0x0800)
+	int startY = (gfxView.BG2Y_L) | ((gfxView.BG2Y_H & 0x07FF)<<16);
+	if(gfxView.BG2Y_H & 0x0800)
 		startY |= 0xF8000000;
 
-	int dx = io_registers[REG_BG2PA] & 0x7FFF;
-	if(io_registers[REG_BG2PA] & 0x8000)
+	int dx = gfxView.io[REG_BG2PA] & 0x7FFF;
+	if(gfxView.io[REG_BG2PA] & 0x8000)
 		dx |= 0xFFFF8000;
-	int dmx = io_registers[REG_BG2PB] & 0x7FFF;
-	if(io_registers[REG_BG2PB] & 0x8000)
+	int dmx = gfxView.io[REG_BG2PB] & 0x7FFF;
+	if(gfxView.io[REG_BG2PB] & 0x8000)
 		dmx |= 0xFFFF8000;
-	int dy = io_registers[REG_BG2PC] & 0x7FFF;
-	if(io_registers[REG_BG2PC] & 0x8000)
+	int dy = gfxView.io[REG_BG2PC] & 0x7FFF;
+	if(gfxView.io[REG_BG2PC] & 0x8000)
 		dy |= 0xFFFF8000;
-	int dmy = io_registers[REG_BG2PD] & 0x7FFF;
-	if(io_registers[REG_BG2PD] & 0x8000)
+	int dmy = gfxView.io[REG_BG2PD] & 0x7FFF;
+	if(gfxView.io[REG_BG2PD] & 0x8000)
 		dmy |= 0xFFFF8000;
 
-	if(io_registers[REG_VCOUNT] == 0)
-		changed = 3;
-
-	currentX += dmx;
-	currentY += dmy;
-
-	if(changed & 1)
-	{
-		currentX = (BG2X_L) | ((BG2X_H & 0x07FF)<<16);
-		if(BG2X_H & 0x0800)
-			currentX |= 0xF8000000;
-	}
-
-	if(changed & 2)
-	{
-		currentY = (BG2Y_L) | ((BG2Y_H & 0x07FF)<<16);
-		if(BG2Y_H & 0x0800)
-			currentY |= 0xF8000000;
-	}
+	gfxAffineStep(currentX, currentY, changed, gfxView.BG2X_L, gfxView.BG2X_H, gfxView.BG2Y_L, gfxView.BG2Y_H, dmx, dmy);
 
 	int realX = currentX;
 	int realY = currentY;
 
-	if(io_registers[REG_BG2CNT] & 0x40) {
-		int mosaicY = ((MOSAIC & 0xF0)>>4) + 1;
-		int y = io_registers[REG_VCOUNT] - (io_registers[REG_VCOUNT] % mosaicY);
+	if(gfxView.io[REG_BG2CNT] & 0x40) {
+		int mosaicY = ((gfxView.MOSAIC & 0xF0)>>4) + 1;
+		int y = gfxView.io[REG_VCOUNT] - (gfxView.io[REG_VCOUNT] % mosaicY);
 		realX = startX + y*dmx;
 		realY = startY + y*dmy;
 	}
@@ -432,12 +678,23 @@ static INLINE void gfxDrawRotScreen256(int &currentX, int& currentY, int changed
 	int xxx = (realX >> 8);
 	int yyy = (realY >> 8);
 
+#ifdef GFX_SIMD
+	if(!(gfxView.io[REG_BG2CNT] & 0x40))
+	{
+		gfxRotLineBitmap(line[2], realX, realY, dx, dy, screenBase, palette, prio, sizeX, sizeY);
+		return;
+	}
+#endif
+
 	memset(line[2], -1, 240 * sizeof(u32));
 	for(u32 x = 0; x < 240; ++x)
 	{
-		u8 color = screenBase[yyy * 240 + xxx];
-		if(unsigned(xxx) < sizeX && unsigned(yyy) < sizeY && color)
-			line[2][x] = (READ16LE(&palette[color])|prio);
+		if(unsigned(xxx) < sizeX && unsigned(yyy) < sizeY)
+		{
+			u8 color = screenBase[yyy * 240 + xxx];
+			if(color)
+				line[2][x] = (READ16LE(&palette[color])|prio);
+		}
 		realX += dx;
 		realY += dy;
 
@@ -445,9 +702,9 @@ static INLINE void gfxDrawRotScreen256(int &currentX, int& currentY, int changed
 		yyy = (realY >> 8);
 	}
 
-	if(io_registers[REG_BG2CNT] & 0x40)
+	if(gfxView.io[REG_BG2CNT] & 0x40)
 	{
-		int mosaicX = (MOSAIC & 0xF) + 1;
+		int mosaicX = (gfxView.MOSAIC & 0xF) + 1;
 		if(mosaicX > 1)
 		{
 			int m = 1;
@@ -466,58 +723,40 @@ static INLINE void gfxDrawRotScreen256(int &currentX, int& currentY, int changed
 
 static INLINE void gfxDrawRotScreen16Bit160(int& currentX, int& currentY, int changed)
 {
-	u16 *screenBase = (io_registers[REG_DISPCNT] & 0x0010) ? (u16 *)&vram[0xa000] :
-		(u16 *)&vram[0];
-	int prio = ((io_registers[REG_BG2CNT] & 3) << 25) + 0x1000000;
+	u16 *screenBase = (gfxView.io[REG_DISPCNT] & 0x0010) ? (u16 *)&gfxVram[0xa000] :
+		(u16 *)&gfxVram[0];
+	int prio = ((gfxView.io[REG_BG2CNT] & 3) << 25) + 0x1000000;
 	u32 sizeX = 160;
 	u32 sizeY = 128;
 
-	int startX = (BG2X_L) | ((BG2X_H & 0x07FF)<<16);
-	if(BG2X_H & 0x0800)
+	int startX = (gfxView.BG2X_L) | ((gfxView.BG2X_H & 0x07FF)<<16);
+	if(gfxView.BG2X_H & 0x0800)
 		startX |= 0xF8000000;
-	int startY = (BG2Y_L) | ((BG2Y_H & 0x07FF)<<16);
-	if(BG2Y_H & 0x0800)
+	int startY = (gfxView.BG2Y_L) | ((gfxView.BG2Y_H & 0x07FF)<<16);
+	if(gfxView.BG2Y_H & 0x0800)
 		startY |= 0xF8000000;
 
-	int dx = io_registers[REG_BG2PA] & 0x7FFF;
-	if(io_registers[REG_BG2PA] & 0x8000)
+	int dx = gfxView.io[REG_BG2PA] & 0x7FFF;
+	if(gfxView.io[REG_BG2PA] & 0x8000)
 		dx |= 0xFFFF8000;
-	int dmx = io_registers[REG_BG2PB] & 0x7FFF;
-	if(io_registers[REG_BG2PB] & 0x8000)
+	int dmx = gfxView.io[REG_BG2PB] & 0x7FFF;
+	if(gfxView.io[REG_BG2PB] & 0x8000)
 		dmx |= 0xFFFF8000;
-	int dy = io_registers[REG_BG2PC] & 0x7FFF;
-	if(io_registers[REG_BG2PC] & 0x8000)
+	int dy = gfxView.io[REG_BG2PC] & 0x7FFF;
+	if(gfxView.io[REG_BG2PC] & 0x8000)
 		dy |= 0xFFFF8000;
-	int dmy = io_registers[REG_BG2PD] & 0x7FFF;
-	if(io_registers[REG_BG2PD] & 0x8000)
+	int dmy = gfxView.io[REG_BG2PD] & 0x7FFF;
+	if(gfxView.io[REG_BG2PD] & 0x8000)
 		dmy |= 0xFFFF8000;
 
-	if(io_registers[REG_VCOUNT] == 0)
-		changed = 3;
-
-	currentX += dmx;
-	currentY += dmy;
-
-	if(changed & 1)
-	{
-		currentX = (BG2X_L) | ((BG2X_H & 0x07FF)<<16);
-		if(BG2X_H & 0x0800)
-			currentX |= 0xF8000000;
-	}
-
-	if(changed & 2)
-	{
-		currentY = (BG2Y_L) | ((BG2Y_H & 0x07FF)<<16);
-		if(BG2Y_H & 0x0800)
-			currentY |= 0xF8000000;
-	}
+	gfxAffineStep(currentX, currentY, changed, gfxView.BG2X_L, gfxView.BG2X_H, gfxView.BG2Y_L, gfxView.BG2Y_H, dmx, dmy);
 
 	int realX = currentX;
 	int realY = currentY;
 
-	if(io_registers[REG_BG2CNT] & 0x40) {
-		int mosaicY = ((MOSAIC & 0xF0)>>4) + 1;
-		int y = io_registers[REG_VCOUNT] - (io_registers[REG_VCOUNT] % mosaicY);
+	if(gfxView.io[REG_BG2CNT] & 0x40) {
+		int mosaicY = ((gfxView.MOSAIC & 0xF0)>>4) + 1;
+		int y = gfxView.io[REG_VCOUNT] - (gfxView.io[REG_VCOUNT] % mosaicY);
 		realX = startX + y*dmx;
 		realY = startY + y*dmy;
 	}
@@ -525,6 +764,14 @@ static INLINE void gfxDrawRotScreen16Bit160(int& currentX, int& currentY, int ch
 	int xxx = (realX >> 8);
 	int yyy = (realY >> 8);
 
+#ifdef GFX_SIMD
+	if(!(gfxView.io[REG_BG2CNT] & 0x40))
+	{
+		gfxRotLineBitmap(line[2], realX, realY, dx, dy, screenBase, NULL, prio, sizeX, sizeY);
+		return;
+	}
+#endif
+
 	memset(line[2], -1, 240 * sizeof(u32));
 	for(u32 x = 0; x < 240u; ++x)
 	{
@@ -539,8 +786,8 @@ static INLINE void gfxDrawRotScreen16Bit160(int& currentX, int& currentY, int ch
 	}
 
 
-	int mosaicX = (MOSAIC & 0xF) + 1;
-	if(io_registers[REG_BG2CNT] & 0x40 && (mosaicX > 1))
+	int mosaicX = (gfxView.MOSAIC & 0xF) + 1;
+	if(gfxView.io[REG_BG2CNT] & 0x40 && (mosaicX > 1))
 	{
 		int m = 1;
 		for(u32 i = 0; i < 239u; ++i)
@@ -555,37 +802,217 @@ static INLINE void gfxDrawRotScreen16Bit160(int& currentX, int& currentY, int ch
 	}
 }
 
+/* Modes 3-5 on the plain renderer with BG2 as the only layer and no
+ * rotation or scaling: the line is one bitmap row, converted straight
+ * into lineMix (through gfxPaletteOut in mode 4), with the backdrop where
+ * the row runs off the bitmap. Returns false when the line needs the
+ * generic path. */
+static bool gfxDrawBitmapLine(pixel_t *lineMix)
+{
+	if((gfxView.layerEnable & 0x1400) != 0x0400 || (gfxView.io[REG_BG2CNT] & 0x40)
+			|| gfxView.io[REG_BG2PA] != 0x100 || gfxView.io[REG_BG2PC] != 0)
+		return false;
+
+	int dmx = gfxView.io[REG_BG2PB] & 0x7FFF;
+	if(gfxView.io[REG_BG2PB] & 0x8000)
+		dmx |= 0xFFFF8000;
+	int dmy = gfxView.io[REG_BG2PD] & 0x7FFF;
+	if(gfxView.io[REG_BG2PD] & 0x8000)
+		dmy |= 0xFFFF8000;
+
+	gfxAffineStep(gfxBG2X, gfxBG2Y, gfxView.bg2Changed, gfxView.BG2X_L, gfxView.BG2X_H, gfxView.BG2Y_L, gfxView.BG2Y_H, dmx, dmy);
+
+	int mode = gfxView.io[REG_DISPCNT] & 7;
+	int sizeX = (mode == 5) ? 160 : 240;
+	int sizeY = (mode == 5) ? 128 : 160;
+	u32 page = (mode != 3 && (gfxView.io[REG_DISPCNT] & 0x0010)) ? 0xA000 : 0x0000;
+
+	int xxx = gfxBG2X >> 8;
+	int yyy = gfxBG2Y >> 8;
+	int first = 0;
+	int end = 0;
+	if(yyy >= 0 && yyy < sizeY)
+	{
+		first = (xxx < 0) ? -xxx : 0;
+		end = sizeX - xxx;
+		if(end > 240)
+			end = 240;
+		if(first > 240)
+			first = 240;
+		if(end < first)
+			end = first;
+	}
+
+	gfxPaletteOutUpdate();
+	pixel_t back = gfxPaletteOut[0];
+	for(int x = 0; x < first; x++)
+		lineMix[x] = back;
+	for(int x = end; x < 240; x++)
+		lineMix[x] = back;
+
+	int x = first;
+	if(mode == 4)
+	{
+		/* colour 0 is transparent and shows the backdrop, palette entry 0 */
+		const u8 *src = &gfxVram[page + yyy * 240];
+		for(; x < end; x++)
+			lineMix[x] = gfxPaletteOut[src[xxx + x]];
+		return true;
+	}
+
+	const u16 *src = (const u16 *)&gfxVram[page] + yyy * sizeX;
+#ifdef GFX_SIMD
+#ifdef FRONTEND_SUPPORTS_XRGB8888
+	for(; x + VEC32_LANES <= end; x += VEC32_LANES)
+		vec32_store(&lineMix[x], vec32_convert_color(vec32_load16(&src[xxx + x])));
+#else
+	for(; x + 2 * VEC32_LANES <= end; x += 2 * VEC32_LANES)
+		vec16_store(&lineMix[x], vec16_convert_color(vec32_load16(&src[xxx + x]),
+					vec32_load16(&src[xxx + x + VEC32_LANES])));
+#endif
+#endif
+	for(; x < end; x++)
+		lineMix[x] = CONVERT_COLOR(READ16LE(&src[xxx + x]));
+	return true;
+}
+
+/* Per-line sprite index: bit n of spriteLines[y] is set when OAM entry n
+ * can draw on (or take OBJ-window cycles from) line y. Entries are moved
+ * between lines from the OAM dirty bits before a line's sprites are drawn.
+ * Coverage only depends on attributes 0 and 1, not on DISPCNT. */
+
+static u32 spriteLines[160][4];
+static u8 spriteLineFirst[128];
+static u8 spriteLineEnd[128];
+static dirty_t spriteLinesDirty;
+static bool spriteLinesTracked = false;
+
+/* set when gfxDrawSprites met a semi-transparent OBJ on the line */
+static bool gfxLineSemiOBJ = false;
+
+static INLINE void gfxSpriteLineRange(u16 a0, u16 a1, int &first, int &end)
+{
+	first = end = 0;
+
+	if ((a0 & 0x0c00) == 0x0c00)
+		a0 &=0xF3FF;
+
+	// disabled OBJ, unless OBJ-WIN which still counts cycles
+	if (((a0 & 0x0c00) != 0x0800) && ((a0 & 0x0300) == 0x0200))
+		return;
+
+	u16 a0val = a0>>14;
+
+	if (a0val == 3)
+	{
+		a0 &= 0x3FFF;
+		a1 &= 0x3FFF;
+	}
+
+	int sizeX = 8<<(a1>>14);
+	int sizeY = sizeX;
+
+	if (a0val & 1)
+	{
+		if (sizeX<32)
+			sizeX<<=1;
+		if (sizeY>8)
+			sizeY>>=1;
+	}
+	else if (a0val & 2)
+	{
+		if (sizeX>8)
+			sizeX>>=1;
+		if (sizeY<32)
+			sizeY<<=1;
+	}
+
+	if ((a0 & 0x0300) == 0x0300)
+		sizeY <<= 1;
+
+	int sy = (a0 & 255);
+	if ((sy+sizeY) > 256)
+		sy -= 256;
+
+	first = sy < 0 ? 0 : sy;
+	end = (sy+sizeY) > 160 ? 160 : (sy+sizeY);
+	if (end < first)
+		end = first;
+}
+
+static INLINE void gfxUpdateSpriteLines(void)
+{
+	if(!spriteLinesTracked)
+		memset(&spriteLinesDirty, 0xff, sizeof(dirty_t));
+	for(int w = 0; w < 4; w++)
+	{
+		u32 bits = spriteLinesDirty.oam[w];
+		if(!bits)
+			continue;
+		spriteLinesDirty.oam[w] = 0;
+
+		for(int b = 0; b < 32; b++)
+		{
+			if(!(bits & (1 << b)))
+				continue;
+
+			int n = (w << 5) + b;
+			u16 *entry = &((u16 *)gfxOam)[n << 2];
+			int first, end;
+			gfxSpriteLineRange(READ16LE(&entry[0]), READ16LE(&entry[1]), first, end);
+			if(first == spriteLineFirst[n] && end == spriteLineEnd[n])
+				continue;
+
+			for(int y = spriteLineFirst[n]; y < spriteLineEnd[n]; y++)
+				spriteLines[y][w] &= ~(1 << b);
+			for(int y = first; y < end; y++)
+				spriteLines[y][w] |= 1 << b;
+			spriteLineFirst[n] = first;
+			spriteLineEnd[n] = end;
+		}
+	}
+}
+
 /* lineOBJpix is used to keep track of the drawn OBJs
    and to stop drawing them if the 'maximum number of OBJ per line'
    has been reached. */
 
 static INLINE void gfxDrawSprites (void)
 {
-	unsigned lineOBJpix, m;
+	unsigned lineOBJpix;
+
+	lineOBJpix = (gfxView.io[REG_DISPCNT] & 0x20) ? 954 : 1226;
 
-	lineOBJpix = (io_registers[REG_DISPCNT] & 0x20) ? 954 : 1226;
-	m = 0;
+	u16 *spritePalette = &((u16 *)gfxPaletteRAM)[256];
+	int mosaicY = ((gfxView.MOSAIC & 0xF000)>>12) + 1;
+
+	gfxUpdateSpriteLines();
+	const u32 *lineSprites = spriteLines[gfxView.io[REG_VCOUNT]];
+	gfxLineSemiOBJ = false;
 
-	u16 *sprites = (u16 *)oam;
-	u16 *spritePalette = &((u16 *)graphics.paletteRAM)[256];
-	int mosaicY = ((MOSAIC & 0xF000)>>12) + 1;
-	int mosaicX = ((MOSAIC & 0xF00)>>8) + 1;
 	for(u32 x = 0; x < 128; x++)
 	{
-		u16 a0 = READ16LE(sprites++);
-		u16 a1 = READ16LE(sprites++);
-		u16 a2 = READ16LE(sprites++);
-		++sprites;
-
 		lineOBJpixleft[x]=lineOBJpix;
 
 		lineOBJpix-=2;
 		if (lineOBJpix<=0)
 			return;
 
+		// sprites off this line only use up their 2 cycles
+		if (!(lineSprites[x >> 5] & (1 << (x & 31))))
+			continue;
+
+		u16 *sprites = &((u16 *)gfxOam)[x << 2];
+		u16 a0 = READ16LE(sprites++);
+		u16 a1 = READ16LE(sprites++);
+		u16 a2 = READ16LE(sprites++);
+
 		if ((a0 & 0x0c00) == 0x0c00)
 			a0 &=0xF3FF;
 
+		if ((a0 & 0x0c00) == 0x0400)
+			gfxLineSemiOBJ = true;
+
 		u16 a0val = a0>>14;
 
 		if (a0val == 3)
@@ -618,7 +1045,7 @@ static INLINE void gfxDrawSprites (void)
 		int sx = (a1 & 0x1FF);
 
 		// computes ticks used by OBJ-WIN if OBJWIN is enabled
-		if (((a0 & 0x0c00) == 0x0800) && (graphics.layerEnable & 0x8000))
+		if (((a0 & 0x0c00) == 0x0800) && (gfxView.layerEnable & 0x8000))
 		{
 			if ((a0 & 0x0300) == 0x0300)
 			{
@@ -639,7 +1066,7 @@ static INLINE void gfxDrawSprites (void)
 			else if ((sx+sizeX)>240)
 				sizeX=240-sx;
 
-			if ((io_registers[REG_VCOUNT]>=sy) && (io_registers[REG_VCOUNT]<sy+sizeY) && (sx<240))
+			if ((gfxView.io[REG_VCOUNT]>=sy) && (gfxView.io[REG_VCOUNT]<sy+sizeY) && (sx<240))
 			{
 				lineOBJpix -= (sizeX-2);
 
@@ -664,7 +1091,7 @@ static INLINE void gfxDrawSprites (void)
 			}
 			if((sy+fieldY) > 256)
 				sy -= 256;
-			int t = io_registers[REG_VCOUNT] - sy;
+			int t = gfxView.io[REG_VCOUNT] - sy;
 			if(unsigned(t) < fieldY)
 			{
 				u32 startpix = 0;
@@ -675,7 +1102,7 @@ static INLINE void gfxDrawSprites (void)
 				{
 					lineOBJpix-=8;
 					int rot = (((a1 >> 9) & 0x1F) << 4);
-					u16 *OAM = (u16 *)oam;
+					u16 *OAM = (u16 *)gfxOam;
 					int dx = READ16LE(&OAM[3 + rot]);
 					if(dx & 0x8000)
 						dx |= 0xFFFF8000;
@@ -698,13 +1125,13 @@ static INLINE void gfxDrawSprites (void)
 					u32 prio = (((a2 >> 10) & 3) << 25) | ((a0 & 0x0c00)<<6);
 
 					int c = (a2 & 0x3FF);
-					if((io_registers[REG_DISPCNT] & 7) > 2 && (c < 512))
+					if((gfxView.io[REG_DISPCNT] & 7) > 2 && (c < 512))
 						continue;
 
 					if(a0 & 0x2000)
 					{
 						int inc = 32;
-						if(io_registers[REG_DISPCNT] & 0x40)
+						if(gfxView.io[REG_DISPCNT] & 0x40)
 							inc = sizeX >> 2;
 						else
 							c &= 0x3FE;
@@ -717,24 +1144,17 @@ static INLINE void gfxDrawSprites (void)
 							if(xxx < sizeX && yyy < sizeY && sx < 240)
 							{
 
-								u32 color = vram[0x10000 + ((((c + (yyy>>3) * inc)<<5)
+								u32 color = gfxVram[0x10000 + ((((c + (yyy>>3) * inc)<<5)
 								+ ((yyy & 7)<<3) + ((xxx >> 3)<<6) + (xxx & 7))&0x7FFF)];
 
 								if ((color==0) && (((prio >> 25)&3) < ((line[4][sx]>>25)&3)))
 								{
 									line[4][sx] = (line[4][sx] & 0xF9FFFFFF) | prio;
-									if((a0 & 0x1000) && m)
-										line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 								}
 								else if((color) && (prio < (line[4][sx]&0xFF000000)))
 								{
 									line[4][sx] = READ16LE(&spritePalette[color]) | prio;
-									if((a0 & 0x1000) && m)
-										line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 								}
-
-								if ((a0 & 0x1000) && ((m+1) == mosaicX))
-									m = 0;
 							}
 							sx = (sx+1)&511;
 							realX += dx;
@@ -744,7 +1164,7 @@ static INLINE void gfxDrawSprites (void)
 					else
 					{
 						int inc = 32;
-						if(io_registers[REG_DISPCNT] & 0x40)
+						if(gfxView.io[REG_DISPCNT] & 0x40)
 							inc = sizeX >> 3;
 						int palette = (a2 >> 8) & 0xF0;
 						for(u32 x = 0; x < fieldX; ++x)
@@ -756,7 +1176,7 @@ static INLINE void gfxDrawSprites (void)
 							if(xxx < sizeX && yyy < sizeY && sx < 240)
 							{
 
-								u32 color = vram[0x10000 + ((((c + (yyy>>3) * inc)<<5)
+								u32 color = gfxVram[0x10000 + ((((c + (yyy>>3) * inc)<<5)
 											+ ((yyy & 7)<<2) + ((xxx >> 3)<<5)
 											+ ((xxx & 7)>>1))&0x7FFF)];
 								if(xxx & 1)
@@ -768,22 +1188,12 @@ static INLINE void gfxDrawSprites (void)
 											((line[4][sx]>>25)&3)))
 								{
 									line[4][sx] = (line[4][sx] & 0xF9FFFFFF) | prio;
-									if((a0 & 0x1000) && m)
-										line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 								}
 								else if((color) && (prio < (line[4][sx]&0xFF000000)))
 								{
 									line[4][sx] = READ16LE(&spritePalette[palette+color]) | prio;
-									if((a0 & 0x1000) && m)
-										line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 								}
 							}
-							if((a0 & 0x1000) && m)
-							{
-								if (++m==mosaicX)
-									m=0;
-							}
-
 							sx = (sx+1)&511;
 							realX += dx;
 							realY += dy;
@@ -797,7 +1207,7 @@ static INLINE void gfxDrawSprites (void)
 		{
 			if(sy+sizeY > 256)
 				sy -= 256;
-			int t = io_registers[REG_VCOUNT] - sy;
+			int t = gfxView.io[REG_VCOUNT] - sy;
 			if(unsigned(t) < sizeY)
 			{
 				u32 startpix = 0;
@@ -812,7 +1222,7 @@ static INLINE void gfxDrawSprites (void)
 						t = sizeY - t - 1;
 
 					int c = (a2 & 0x3FF);
-					if((io_registers[REG_DISPCNT] & 7) > 2 && (c < 512))
+					if((gfxView.io[REG_DISPCNT] & 7) > 2 && (c < 512))
 						continue;
 
 					int inc = 32;
@@ -825,7 +1235,7 @@ static INLINE void gfxDrawSprites (void)
 
 					if(a0 & 0x2000)
 					{
-						if(io_registers[REG_DISPCNT] & 0x40)
+						if(gfxView.io[REG_DISPCNT] & 0x40)
 							inc = sizeX >> 2;
 						else
 							c &= 0x3FE;
@@ -843,23 +1253,16 @@ static INLINE void gfxDrawSprites (void)
 								--lineOBJpix;
 							if(sx < 240)
 							{
-								u8 color = vram[address];
+								u8 color = gfxVram[address];
 								if ((color==0) && (((prio >> 25)&3) <
 											((line[4][sx]>>25)&3)))
 								{
 									line[4][sx] = (line[4][sx] & 0xF9FFFFFF) | prio;
-									if((a0 & 0x1000) && m)
-										line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 								}
 								else if((color) && (prio < (line[4][sx]&0xFF000000)))
 								{
 									line[4][sx] = READ16LE(&spritePalette[color]) | prio;
-									if((a0 & 0x1000) && m)
-										line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 								}
-
-								if ((a0 & 0x1000) && ((m+1) == mosaicX))
-									m = 0;
 							}
 
 							sx = (sx+1) & 511;
@@ -889,7 +1292,7 @@ static INLINE void gfxDrawSprites (void)
 					}
 					else
 					{
-						if(io_registers[REG_DISPCNT] & 0x40)
+						if(gfxView.io[REG_DISPCNT] & 0x40)
 							inc = sizeX >> 3;
 
 						int address = 0x10000 + ((((c + (t>>3) * inc)<<5)
@@ -909,7 +1312,7 @@ static INLINE void gfxDrawSprites (void)
 								//  continue;
 								if(sx < 240)
 								{
-									u8 color = vram[address];
+									u8 color = gfxVram[address];
 									if(xx & 1)
 										color >>= 4;
 									else
@@ -919,20 +1322,13 @@ static INLINE void gfxDrawSprites (void)
 												((line[4][sx]>>25)&3)))
 									{
 										line[4][sx] = (line[4][sx] & 0xF9FFFFFF) | prio;
-										if((a0 & 0x1000) && m)
-											line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 									}
 									else if((color) && (prio < (line[4][sx]&0xFF000000)))
 									{
 										line[4][sx] = READ16LE(&spritePalette[palette + color]) | prio;
-										if((a0 & 0x1000) && m)
-											line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 									}
 								}
 
-								if ((a0 & 0x1000) && ((m+1) == mosaicX))
-									m=0;
-
 								sx = (sx+1) & 511;
 								if(!(xx & 1))
 									--address;
@@ -955,7 +1351,7 @@ static INLINE void gfxDrawSprites (void)
 								//  continue;
 								if(sx < 240)
 								{
-									u8 color = vram[address];
+									u8 color = gfxVram[address];
 									if(xx & 1)
 										color >>= 4;
 									else
@@ -965,19 +1361,12 @@ static INLINE void gfxDrawSprites (void)
 												((line[4][sx]>>25)&3)))
 									{
 										line[4][sx] = (line[4][sx] & 0xF9FFFFFF) | prio;
-										if((a0 & 0x1000) && m)
-											line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
 									}
 									else if((color) && (prio < (line[4][sx]&0xFF000000)))
 									{
 										line[4][sx] = READ16LE(&spritePalette[palette + color]) | prio;
-										if((a0 & 0x1000) && m)
-											line[4][sx]=(line[4][sx-1] & 0xF9FFFFFF) | prio;
-
 									}
 								}
-								if ((a0 & 0x1000) && ((m+1) == mosaicX))
-									m=0;
 
 								sx = (sx+1) & 511;
 								if(xx & 1)
@@ -1000,7 +1389,7 @@ static INLINE void gfxDrawSprites (void)
 
 static INLINE void gfxDrawOBJWin (void)
 {
-	u16 *sprites = (u16 *)oam;
+	u16 *sprites = (u16 *)gfxOam;
 	for(int x = 0; x < 128 ; x++)
 	{
 		int lineOBJpix = lineOBJpixleft[x];
@@ -1058,7 +1447,7 @@ static INLINE void gfxDrawOBJWin (void)
 			}
 			if((sy+fieldY) > 256)
 				sy -= 256;
-			int t = io_registers[REG_VCOUNT] - sy;
+			int t = gfxView.io[REG_VCOUNT] - sy;
 			if((t >= 0) && (t < fieldY))
 			{
 				int sx = (a1 & 0x1FF);
@@ -1071,7 +1460,7 @@ static INLINE void gfxDrawOBJWin (void)
 					lineOBJpix-=8;
 					// int t2 = t - (fieldY >> 1);
 					int rot = (a1 >> 9) & 0x1F;
-					u16 *OAM = (u16 *)oam;
+					u16 *OAM = (u16 *)gfxOam;
 					int dx = READ16LE(&OAM[3 + (rot << 4)]);
 					if(dx & 0x8000)
 						dx |= 0xFFFF8000;
@@ -1091,13 +1480,13 @@ static INLINE void gfxDrawOBJWin (void)
 						+ t * dmy;
 
 					int c = (a2 & 0x3FF);
-					if((io_registers[REG_DISPCNT] & 7) > 2 && (c < 512))
+					if((gfxView.io[REG_DISPCNT] & 7) > 2 && (c < 512))
 						continue;
 
 					int inc = 32;
 					bool condition1 = a0 & 0x2000;
 
-					if(io_registers[REG_DISPCNT] & 0x40)
+					if(gfxView.io[REG_DISPCNT] & 0x40)
 						inc = sizeX >> 3;
 
 					for(int x = 0; x < fieldX; x++)
@@ -1117,12 +1506,12 @@ static INLINE void gfxDrawOBJWin (void)
 						{
 							u32 color;
 							if(condition1)
-								color = vram[0x10000 + ((((c + (yyy>>3) * inc)<<5)
+								color = gfxVram[0x10000 + ((((c + (yyy>>3) * inc)<<5)
 											+ ((yyy & 7)<<3) + ((xxx >> 3)<<6) +
 											(xxx & 7))&0x7fff)];
 							else
 							{
-								color = vram[0x10000 + ((((c + (yyy>>3) * inc)<<5)
+								color = gfxVram[0x10000 + ((((c + (yyy>>3) * inc)<<5)
 											+ ((yyy & 7)<<2) + ((xxx >> 3)<<5) +
 											((xxx & 7)>>1))&0x7fff)];
 								if(xxx & 1)
@@ -1145,7 +1534,7 @@ static INLINE void gfxDrawOBJWin (void)
 		{
 			if((sy+sizeY) > 256)
 				sy -= 256;
-			int t = io_registers[REG_VCOUNT] - sy;
+			int t = gfxView.io[REG_VCOUNT] - sy;
 			if((t >= 0) && (t < sizeY))
 			{
 				int sx = (a1 & 0x1FF);
@@ -1159,13 +1548,13 @@ static INLINE void gfxDrawOBJWin (void)
 					if(a1 & 0x2000)
 						t = sizeY - t - 1;
 					int c = (a2 & 0x3FF);
-					if((io_registers[REG_DISPCNT] & 7) > 2 && (c < 512))
+					if((gfxView.io[REG_DISPCNT] & 7) > 2 && (c < 512))
 						continue;
 					if(a0 & 0x2000)
 					{
 
 						int inc = 32;
-						if(io_registers[REG_DISPCNT] & 0x40)
+						if(gfxView.io[REG_DISPCNT] & 0x40)
 							inc = sizeX >> 2;
 						else
 							c &= 0x3FE;
@@ -1185,7 +1574,7 @@ static INLINE void gfxDrawOBJWin (void)
 								continue;
 							if(sx < 240)
 							{
-								u8 color = vram[address];
+								u8 color = gfxVram[address];
 								if(color)
 									line[5][sx] = 1;
 							}
@@ -1215,7 +1604,7 @@ static INLINE void gfxDrawOBJWin (void)
 					else
 					{
 						int inc = 32;
-						if(io_registers[REG_DISPCNT] & 0x40)
+						if(gfxView.io[REG_DISPCNT] & 0x40)
 							inc = sizeX >> 3;
 						int xxx = 0;
 						if(a1 & 0x1000)
@@ -1235,7 +1624,7 @@ static INLINE void gfxDrawOBJWin (void)
 									continue;
 								if(sx < 240)
 								{
-									u8 color = vram[address];
+									u8 color = gfxVram[address];
 									if(xx & 1)
 										color = (color >> 4);
 									else
@@ -1266,7 +1655,7 @@ static INLINE void gfxDrawOBJWin (void)
 									continue;
 								if(sx < 240)
 								{
-									u8 color = vram[address];
+									u8 color = gfxVram[address];
 									if(xx & 1)
 										color = (color >> 4);
 									else
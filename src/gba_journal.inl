@@ -0,0 +1,399 @@
+/*============================================================
+	GBA FRAME JOURNAL
+============================================================ */
+
+/* Deferred rendering: instead of drawing each line when its HDraw ends,
+ * CPULoop records what the line will be drawn from (a gfx_view_t) and
+ * keeps running. VRAM, OAM and palette writes made after the first
+ * recorded line are logged through dirtyMark*() with the bytes they
+ * replaced.
+ * frameJournalFlush() undoes the logged writes, then draws the recorded
+ * lines in one pass, redoing each write (and marking it dirty) at the
+ * point it was made. The output, and everything the renderers leave
+ * behind, is the same as drawing each line on time. A flush is valid at
+ * any point; it happens at VBlank, before anything reads pix or the
+ * state, and when the logs fill up.
+ *
+ * With THREADED_RENDER the same records go through two single-producer
+ * rings to a render thread. It keeps its own copy of VRAM, OAM and
+ * palette (gfxVram, gfxOam, gfxPaletteRAM) and brings it forward with
+ * the logged writes, so nothing has to be undone and the CPU only waits
+ * for it at a flush or when a ring is full. */
+
+#define FRAME_JOURNAL_LINES	256
+#define FRAME_JOURNAL_WRITES	16384
+
+typedef struct
+{
+	gfx_view_t view;		/* view.renderLine NULL: only the writes and clears */
+	u32 clearLines;			/* line[n] erased by DISPCNT since the previous line */
+	u32 writes;			/* logged writes made before the line */
+} frame_journal_line_t;
+
+typedef struct
+{
+	u8 kind;
+	u8 size;
+	u32 address;
+	u8 before[4];
+	u8 after[4];
+} frame_journal_write_t;
+
+static frame_journal_line_t frameJournalLines[FRAME_JOURNAL_LINES];
+static frame_journal_write_t frameJournalWrites[FRAME_JOURNAL_WRITES];
+static u32 frameJournalLineCount = 0;
+static u32 frameJournalWriteCount = 0;
+static u32 frameJournalClearLines = 0;
+#if defined(DEFERRED_RENDER) || defined(THREADED_RENDER)
+static bool frameJournalEnabled = true;
+#else
+static bool frameJournalEnabled = false;
+#endif
+
+/* where a write lands in the memory the renderers draw from */
+static INLINE u8 * frameJournalView(int kind, u32 address)
+{
+	switch(kind)
+	{
+		case DIRTY_KIND_VRAM:
+			return &gfxVram[address];
+		case DIRTY_KIND_OAM:
+			return &gfxOam[address];
+		default:
+			return &gfxPaletteRAM[address];
+	}
+}
+
+static void frameJournalRedo(const frame_journal_write_t *w)
+{
+	dirtyMarkKind(w->kind, w->address, w->size);
+	memcpy(frameJournalView(w->kind, w->address), w->after, w->size);
+}
+
+/* redoes the writes made before l, from next on, then draws l */
+static u32 frameJournalReplay(const frame_journal_line_t *l, u32 next)
+{
+	for(; next != l->writes; next++)
+		frameJournalRedo(&frameJournalWrites[next & (FRAME_JOURNAL_WRITES - 1)]);
+	for(int n = 0; n < 4; n++)
+		if(l->clearLines & (1 << n))
+			memset(line[n], -1, 240 * sizeof(u32));
+
+	if(l->view.renderLine)
+	{
+		gfxViewLoad(&l->view);
+		CPUDrawLine();
+	}
+	return next;
+}
+
+#ifdef THREADED_RENDER
+static u32 frameJournalLinesDone = 0;	/* written by the render side only */
+static u32 frameJournalWritesDone = 0;
+
+/* draws what was pushed; on the render thread, or on the CPU thread
+ * when there is none */
+static void frameJournalDrain(void)
+{
+	u32 pushed = __atomic_load_n(&frameJournalLineCount, __ATOMIC_ACQUIRE);
+	u32 done = frameJournalLinesDone;
+	u32 next = frameJournalWritesDone;
+
+	while(done != pushed)
+	{
+		next = frameJournalReplay(&frameJournalLines[done & (FRAME_JOURNAL_LINES - 1)], next);
+		done++;
+		__atomic_store_n(&frameJournalWritesDone, next, __ATOMIC_RELEASE);
+		__atomic_store_n(&frameJournalLinesDone, done, __ATOMIC_SEQ_CST);
+	}
+}
+#endif
+
+/* where a write lands in the machine's memory */
+static INLINE u8 * frameJournalMemory(int kind, u32 address)
+{
+	switch(kind)
+	{
+		case DIRTY_KIND_VRAM:
+			return &vram[address];
+		case DIRTY_KIND_OAM:
+			return &oam[address];
+		default:
+			return &graphics.paletteRAM[address];
+	}
+}
+
+#ifdef THREADED_RENDER
+
+static pthread_t renderThread;
+static pthread_mutex_t renderThreadLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t renderThreadWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t renderThreadDone = PTHREAD_COND_INITIALIZER;
+static bool renderThreadRunning = false;
+static int renderThreadQuit = 0;
+static int renderThreadIdle = 0;	/* render thread asleep on renderThreadWork */
+static int renderThreadWaiting = 0;	/* CPU thread asleep on renderThreadDone */
+static u32 frameJournalWritesPushed = 0;
+
+/* returns once *counter moved off value (or on quit); spins a little
+ * before going to sleep on cond */
+static void renderThreadSleep(u32 *counter, u32 value, int *asleep, pthread_cond_t *cond)
+{
+	for(int spin = 0; spin < 4096; spin++)
+		if(__atomic_load_n(counter, __ATOMIC_ACQUIRE) != value || __atomic_load_n(&renderThreadQuit, __ATOMIC_ACQUIRE))
+			return;
+
+	pthread_mutex_lock(&renderThreadLock);
+	__atomic_store_n(asleep, 1, __ATOMIC_SEQ_CST);
+	while(__atomic_load_n(counter, __ATOMIC_SEQ_CST) == value && !__atomic_load_n(&renderThreadQuit, __ATOMIC_SEQ_CST))
+		pthread_cond_wait(cond, &renderThreadLock);
+	__atomic_store_n(asleep, 0, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&renderThreadLock);
+}
+
+static void renderThreadWake(int *asleep, pthread_cond_t *cond)
+{
+	if(!__atomic_load_n(asleep, __ATOMIC_SEQ_CST))
+		return;
+	pthread_mutex_lock(&renderThreadLock);
+	pthread_cond_signal(cond);
+	pthread_mutex_unlock(&renderThreadLock);
+}
+
+static void *renderThreadMain(void *arg)
+{
+	for(;;)
+	{
+		renderThreadSleep(&frameJournalLineCount, frameJournalLinesDone, &renderThreadIdle, &renderThreadWork);
+		if(__atomic_load_n(&renderThreadQuit, __ATOMIC_ACQUIRE))
+			return NULL;
+		frameJournalDrain();
+		renderThreadWake(&renderThreadWaiting, &renderThreadDone);
+	}
+}
+
+static void renderThreadStart(void)
+{
+	__atomic_store_n(&renderThreadQuit, 0, __ATOMIC_SEQ_CST);
+	if(pthread_create(&renderThread, NULL, renderThreadMain, NULL) == 0)
+		renderThreadRunning = true;
+	else
+		frameJournalEnabled = false;
+}
+
+/* the renderer's memory (allocated with the machine's by CPULoadRom)
+ * starts over from the machine's */
+static void frameJournalReload(void)
+{
+	memcpy(gfxVram, vram, 0x20000);
+	memcpy(gfxOam, oam, 0x400);
+	memcpy(gfxPaletteRAM, graphics.paletteRAM, 0x400);
+	dirtyDeferred = true;
+}
+
+/* hands the line (or just the writes and clears) logged so far to the
+ * render side */
+static void frameJournalPush(bool draw)
+{
+	if(frameJournalEnabled && !renderThreadRunning)
+		renderThreadStart();
+
+	u32 done;
+	while(frameJournalLineCount - (done = __atomic_load_n(&frameJournalLinesDone, __ATOMIC_ACQUIRE)) == FRAME_JOURNAL_LINES)
+		renderThreadSleep(&frameJournalLinesDone, done, &renderThreadWaiting, &renderThreadDone);
+
+	frame_journal_line_t *l = &frameJournalLines[frameJournalLineCount & (FRAME_JOURNAL_LINES - 1)];
+	if(draw)
+		gfxViewSave(&l->view);
+	else
+		l->view.renderLine = NULL;
+	l->clearLines = frameJournalClearLines;
+	frameJournalClearLines = 0;
+
+	// what the writes stored; a later one to the same place is logged after them
+	for(u32 i = frameJournalWritesPushed; i != frameJournalWriteCount; i++)
+	{
+		frame_journal_write_t *w = &frameJournalWrites[i & (FRAME_JOURNAL_WRITES - 1)];
+		memcpy(w->after, frameJournalMemory(w->kind, w->address), w->size);
+	}
+	frameJournalWritesPushed = frameJournalWriteCount;
+	l->writes = frameJournalWriteCount;
+
+	__atomic_store_n(&frameJournalLineCount, frameJournalLineCount + 1, __ATOMIC_SEQ_CST);
+	if(renderThreadRunning)
+		renderThreadWake(&renderThreadIdle, &renderThreadWork);
+	else
+		frameJournalDrain();
+}
+
+/* waits until the render side has caught up with everything logged */
+static void frameJournalFlush(void)
+{
+	if(frameJournalWritesPushed != frameJournalWriteCount || frameJournalClearLines)
+		frameJournalPush(false);
+
+	u32 done;
+	while((done = __atomic_load_n(&frameJournalLinesDone, __ATOMIC_ACQUIRE)) != frameJournalLineCount)
+		renderThreadSleep(&frameJournalLinesDone, done, &renderThreadWaiting, &renderThreadDone);
+}
+
+/* called by dirtyMark*() before the write lands */
+static void frameJournalWrite(int kind, u32 address, u32 size)
+{
+	if(size > 4)
+	{
+		// bulk marks (the BIOS RAM reset) come after the write
+		frameJournalFlush();
+		dirtyMarkKind(kind, address, size);
+		memcpy(frameJournalView(kind, address), frameJournalMemory(kind, address), size);
+		return;
+	}
+
+	if(frameJournalWriteCount - __atomic_load_n(&frameJournalWritesDone, __ATOMIC_ACQUIRE) == FRAME_JOURNAL_WRITES)
+		frameJournalFlush();
+
+	frame_journal_write_t *w = &frameJournalWrites[frameJournalWriteCount & (FRAME_JOURNAL_WRITES - 1)];
+	w->kind = kind;
+	w->size = size;
+	w->address = address;
+	frameJournalWriteCount++;
+}
+
+static void frameJournalClear(u32 layers)
+{
+	if(gfxVram)
+	{
+		frameJournalClearLines |= layers;
+		return;
+	}
+	for(int n = 0; n < 4; n++)
+		if(layers & (1 << n))
+			memset(line[n], -1, 240 * sizeof(u32));
+}
+
+static void frameJournalLine(void)
+{
+	frameJournalPush(true);
+}
+
+static void frameJournalStop(void)
+{
+	frameJournalFlush();
+	if(!renderThreadRunning)
+		return;
+
+	__atomic_store_n(&renderThreadQuit, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_lock(&renderThreadLock);
+	pthread_cond_signal(&renderThreadWork);
+	pthread_mutex_unlock(&renderThreadLock);
+	pthread_join(renderThread, NULL);
+	renderThreadRunning = false;
+}
+
+/* Threaded builds always draw through the journal; turned off, the
+ * lines are replayed on the CPU thread as they are pushed. */
+void CPUSetDeferredRender(bool enable)
+{
+	frameJournalStop();
+	frameJournalEnabled = enable;
+}
+
+#else
+
+/* called by dirtyMark*() before the write lands */
+static void frameJournalWrite(int kind, u32 address, u32 size)
+{
+	if(frameJournalWriteCount == FRAME_JOURNAL_WRITES)
+	{
+		frameJournalFlush();
+		dirtyMarkKind(kind, address, size);
+		return;
+	}
+
+	frame_journal_write_t *w = &frameJournalWrites[frameJournalWriteCount++];
+	w->kind = kind;
+	w->size = size;
+	w->address = address;
+	memcpy(w->before, frameJournalMemory(kind, address), size);
+}
+
+/* DISPCNT erases the buffers of BGs it turns off; they belong to the
+ * renderers, so with lines pending that waits for the replay */
+static void frameJournalClear(u32 layers)
+{
+	if(frameJournalLineCount)
+	{
+		frameJournalClearLines |= layers;
+		return;
+	}
+	for(int n = 0; n < 4; n++)
+		if(layers & (1 << n))
+			memset(line[n], -1, 240 * sizeof(u32));
+}
+
+/* records the current line instead of drawing it */
+static void frameJournalLine(void)
+{
+	if(!frameJournalEnabled)
+	{
+		gfx_view_t view;
+		gfxViewSave(&view);
+		gfxViewLoad(&view);
+		CPUDrawLine();
+		return;
+	}
+	if(frameJournalLineCount == FRAME_JOURNAL_LINES)
+		frameJournalFlush();
+
+	frame_journal_line_t *l = &frameJournalLines[frameJournalLineCount++];
+	gfxViewSave(&l->view);
+	l->clearLines = frameJournalClearLines;
+	l->writes = frameJournalWriteCount;
+	frameJournalClearLines = 0;
+	dirtyDeferred = true;
+}
+
+static void frameJournalFlush(void)
+{
+	if(!frameJournalLineCount)
+		return;
+
+	dirtyDeferred = false;
+
+	// back to the memory the first line saw
+	for(int i = frameJournalWriteCount - 1; i >= 0; i--)
+	{
+		frame_journal_write_t *w = &frameJournalWrites[i];
+		u8 *p = frameJournalMemory(w->kind, w->address);
+		memcpy(w->after, p, w->size);
+		memcpy(p, w->before, w->size);
+	}
+
+	u32 next = 0;
+	for(u32 i = 0; i < frameJournalLineCount; i++)
+		next = frameJournalReplay(&frameJournalLines[i], next);
+	for(; next < frameJournalWriteCount; next++)
+		frameJournalRedo(&frameJournalWrites[next]);
+
+	frameJournalLineCount = 0;
+	frameJournalWriteCount = 0;
+	frameJournalClear(frameJournalClearLines);
+	frameJournalClearLines = 0;
+}
+
+static void frameJournalReload(void)
+{
+}
+
+static void frameJournalStop(void)
+{
+	frameJournalFlush();
+}
+
+void CPUSetDeferredRender(bool enable)
+{
+	frameJournalFlush();
+	frameJournalEnabled = enable;
+}
+
+#endif
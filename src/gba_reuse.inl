@@ -0,0 +1,198 @@
+/*============================================================
+	GBA LINE REUSE
+============================================================ */
+
+/* A line already in pix is not drawn again when nothing it depends on
+ * changed since the previous frame: its signature (display registers,
+ * the affine reference points it will use, the renderer) must match, and
+ * none of the VRAM blocks, OAM entries and palette entries it read may
+ * be dirty. Dirty bits are kept for the previous and the current frame,
+ * which covers everything written since the line was last drawn. */
+
+typedef struct
+{
+	void (*render)(void);
+	int affine[4];
+	u16 regs[REG_BLDY + 1];
+	u16 mosaic, bldmod, colev, coly, layerEnable;
+	u16 bgref[8];
+} line_signature_t;
+
+typedef struct
+{
+	bool valid;
+	line_signature_t sig;
+	dirty_t reads;
+} line_reuse_t;
+
+static line_reuse_t lineReuse[160];
+static line_signature_t lineReuseSig;
+static dirty_t lineReuseDirty;			/* written this frame, registered consumer */
+static dirty_t lineReusePrevDirty;		/* written last frame */
+static bool lineReuseEnabled = true;		/* off when lineReuseDirty got no consumer slot */
+static u32 lineReuseChanged[(160 + 31) >> 5];	/* lines of this frame that came out different */
+static u32 lineReusePrevChanged[(160 + 31) >> 5];
+static pixel_t lineReuseOld[240];		/* the line being drawn, as it was */
+static bool lineReuseFull = false;		/* pix was replaced since the last frame went out */
+
+/* the affine reference points the renderer will leave after this line */
+static INLINE void lineReuseAffine(int *affine)
+{
+	affine[0] = gfxBG2X;
+	affine[1] = gfxBG2Y;
+	affine[2] = gfxBG3X;
+	affine[3] = gfxBG3Y;
+
+	if(gfxView.mode == 0)
+		return;
+
+	if(gfxView.layerEnable & 0x0400)
+	{
+		int dmx = gfxView.io[REG_BG2PB] & 0x7FFF;
+		if(gfxView.io[REG_BG2PB] & 0x8000)
+			dmx |= 0xFFFF8000;
+		int dmy = gfxView.io[REG_BG2PD] & 0x7FFF;
+		if(gfxView.io[REG_BG2PD] & 0x8000)
+			dmy |= 0xFFFF8000;
+		gfxAffineStep(affine[0], affine[1], gfxView.bg2Changed, gfxView.BG2X_L, gfxView.BG2X_H, gfxView.BG2Y_L, gfxView.BG2Y_H, dmx, dmy);
+	}
+
+	if(gfxView.mode == 2 && (gfxView.layerEnable & 0x0800))
+	{
+		int dmx = gfxView.io[REG_BG3PB] & 0x7FFF;
+		if(gfxView.io[REG_BG3PB] & 0x8000)
+			dmx |= 0xFFFF8000;
+		int dmy = gfxView.io[REG_BG3PD] & 0x7FFF;
+		if(gfxView.io[REG_BG3PD] & 0x8000)
+			dmy |= 0xFFFF8000;
+		gfxAffineStep(affine[2], affine[3], gfxView.bg3Changed, gfxView.BG3X_L, gfxView.BG3X_H, gfxView.BG3Y_L, gfxView.BG3Y_H, dmx, dmy);
+	}
+}
+
+/* VRAM a rotation BG can reach: 256 tiles of its char base and its map */
+static INLINE void lineReuseReadRot(dirty_t *reads, u16 control)
+{
+	u32 size = map_sizes_rot[(control >> 14) & 3];
+	dirtySetVram(reads, ((control >> 2) & 0x03) << 14, 0x4000);
+	dirtySetVram(reads, ((control >> 8) & 0x1f) << 11, (size * size) >> 6);
+}
+
+/* Returns true when the current line can be left as it is. Otherwise
+ * the caller draws it and then calls lineReuseEnd(). */
+static bool lineReuseBegin(void)
+{
+	u32 y = gfxView.io[REG_VCOUNT];
+
+	if(y == 0)
+	{
+		lineReusePrevDirty = lineReuseDirty;
+		dirtyClear(&lineReuseDirty);
+		memcpy(lineReusePrevChanged, lineReuseChanged, sizeof(lineReuseChanged));
+		memset(lineReuseChanged, 0, sizeof(lineReuseChanged));
+	}
+
+	line_signature_t *sig = &lineReuseSig;
+	sig->render = gfxView.renderLine;
+	lineReuseAffine(sig->affine);
+	memcpy(sig->regs, gfxView.io, sizeof(sig->regs));
+	sig->regs[REG_DISPSTAT] = 0;
+	sig->mosaic = gfxView.MOSAIC;
+	sig->bldmod = gfxView.BLDMOD;
+	sig->colev = gfxView.COLEV;
+	sig->coly = gfxView.COLY;
+	sig->layerEnable = gfxView.layerEnable;
+	sig->bgref[0] = gfxView.BG2X_L;
+	sig->bgref[1] = gfxView.BG2X_H;
+	sig->bgref[2] = gfxView.BG2Y_L;
+	sig->bgref[3] = gfxView.BG2Y_H;
+	sig->bgref[4] = gfxView.BG3X_L;
+	sig->bgref[5] = gfxView.BG3X_H;
+	sig->bgref[6] = gfxView.BG3Y_L;
+	sig->bgref[7] = gfxView.BG3Y_H;
+
+	line_reuse_t *l = &lineReuse[y];
+	if(!lineReuseEnabled || !l->valid || memcmp(&l->sig, sig, sizeof(line_signature_t))
+			|| dirtyIntersects(&l->reads, &lineReuseDirty)
+			|| dirtyIntersects(&l->reads, &lineReusePrevDirty))
+	{
+		dirtyClear(&gfxLineReads);
+		if(pixOut == pix)
+			memcpy(lineReuseOld, &pix[PIX_BUFFER_SCREEN_WIDTH * y], sizeof(lineReuseOld));
+		return false;
+	}
+
+	/* what the renderer would have done to the affine state */
+	gfxBG2X = sig->affine[0];
+	gfxBG2Y = sig->affine[1];
+	gfxBG3X = sig->affine[2];
+	gfxBG3Y = sig->affine[3];
+	if(gfxView.mode != 0)
+		gfxView.bg2Changed = 0;
+	if(gfxView.mode == 2)
+		gfxView.bg3Changed = 0;
+	return true;
+}
+
+static void lineReuseEnd(void)
+{
+	u32 y = gfxView.io[REG_VCOUNT];
+	line_reuse_t *l = &lineReuse[y];
+	dirty_t *reads = &l->reads;
+
+	if(pixOut != pix || memcmp(lineReuseOld, &pix[PIX_BUFFER_SCREEN_WIDTH * y], sizeof(lineReuseOld)))
+		lineReuseChanged[y >> 5] |= 1 << (y & 31);
+
+	*reads = gfxLineReads;
+	memset(reads->palette, 0xff, sizeof(reads->palette) / 2);
+
+	if(gfxView.layerEnable & 0x1000)
+	{
+		memset(reads->oam, 0xff, sizeof(reads->oam));
+		memset(&reads->palette[DIRTY_PALETTE_ENTRIES >> 6], 0xff, sizeof(reads->palette) / 2);
+		dirtySetVram(reads, 0x10000, 0x8000);
+	}
+
+	u32 page = (gfxView.io[REG_DISPCNT] & 0x0010) ? 0xA000 : 0x0000;
+	switch(gfxView.mode)
+	{
+		case 1:
+			if(gfxView.layerEnable & 0x0400)
+				lineReuseReadRot(reads, gfxView.io[REG_BG2CNT]);
+			break;
+		case 2:
+			if(gfxView.layerEnable & 0x0400)
+				lineReuseReadRot(reads, gfxView.io[REG_BG2CNT]);
+			if(gfxView.layerEnable & 0x0800)
+				lineReuseReadRot(reads, gfxView.io[REG_BG3CNT]);
+			break;
+		case 3:
+			if(gfxView.layerEnable & 0x0400)
+				dirtySetVram(reads, 0, 240 * 160 * 2);
+			break;
+		case 4:
+			if(gfxView.layerEnable & 0x0400)
+				dirtySetVram(reads, page, 240 * 160);
+			break;
+		case 5:
+			if(gfxView.layerEnable & 0x0400)
+				dirtySetVram(reads, page, 160 * 128 * 2);
+			break;
+	}
+
+	l->sig = lineReuseSig;
+	l->valid = (pixOut == pix);	/* frontend buffers are not kept */
+}
+
+/* word i of the lines that went out different; a blended line also
+ * changes when the line before it did */
+static INLINE u32 lineReuseChangedBits(int i)
+{
+	return lineReuseChanged[i] | (frameBlend ? lineReusePrevChanged[i] : 0);
+}
+
+static void lineReuseReset(void)
+{
+	for(int i = 0; i < 160; i++)
+		lineReuse[i].valid = false;
+	lineReuseFull = true;
+}
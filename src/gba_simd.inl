@@ -0,0 +1,190 @@
+/*============================================================
+	GBA SIMD
+============================================================ */
+
+/* Thin wrappers so the vector kernels (affine BGs in gba_gfx.inl, line
+ * compositing in gba_composite.inl) are written once for SSE2, AVX2
+ * and NEON. vec32 holds VEC32_LANES 32-bit pixels (the
+ * line[] format), vec16 holds twice as many 16-bit output pixels. */
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GFX_SIMD
+#define VEC32_LANES 8
+typedef __m256i vec32;
+typedef __m256i vec16;
+#define vec32_load(p)		_mm256_loadu_si256((const __m256i *)(p))
+#define vec32_store(p, v)	_mm256_storeu_si256((__m256i *)(p), v)
+#define vec32_set1(x)		_mm256_set1_epi32(x)
+#define vec32_and(a, b)		_mm256_and_si256(a, b)
+#define vec32_or(a, b)		_mm256_or_si256(a, b)
+#define vec32_xor(a, b)		_mm256_xor_si256(a, b)
+#define vec32_srl(v, n)		_mm256_srli_epi32(v, n)
+#define vec32_sll(v, n)		_mm256_slli_epi32(v, n)
+#define vec32_sllv(v, n)	_mm256_sll_epi32(v, _mm_cvtsi32_si128(n))
+#define vec32_add(a, b)		_mm256_add_epi32(a, b)
+#define vec32_sub(a, b)		_mm256_sub_epi32(a, b)
+#define vec32_mul16(a, b)	_mm256_mullo_epi16(a, b)	/* lanes and products < 2^16 */
+#define vec32_min16(a, b)	_mm256_min_epi16(a, b)		/* lanes < 2^15 */
+#define vec32_lt(a, b)		_mm256_cmpgt_epi32(b, a)	/* operands < 2^31 */
+#define vec32_eq(a, b)		_mm256_cmpeq_epi32(a, b)
+#define vec32_select(m, a, b)	_mm256_blendv_epi8(b, a, m)
+#define vec32_any(m)		(_mm256_movemask_epi8(m) != 0)
+#define vec32_signbits(v)	_mm256_movemask_ps(_mm256_castsi256_ps(v))
+#define vec32_gather8(p, i)	_mm256_and_si256(_mm256_i32gather_epi32((const int *)(p), i, 1), _mm256_set1_epi32(0xff))
+#define vec32_gather16(p, i)	_mm256_and_si256(_mm256_i32gather_epi32((const int *)(p), i, 2), _mm256_set1_epi32(0xffff))
+#define vec32_gather32(p, i)	_mm256_i32gather_epi32((const int *)(p), i, 4)
+/* low 16 bits of each lane, in order */
+#define vec16_pack16(a, b)	_mm256_permute4x64_epi64(_mm256_packs_epi32( \
+		_mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16), \
+		_mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16)), 0xD8)
+#define vec16_store(p, v)	_mm256_storeu_si256((__m256i *)(p), v)
+#define vec32_load16(p)		_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GFX_SIMD
+#define VEC32_LANES 4
+typedef __m128i vec32;
+typedef __m128i vec16;
+#define vec32_load(p)		_mm_loadu_si128((const __m128i *)(p))
+#define vec32_store(p, v)	_mm_storeu_si128((__m128i *)(p), v)
+#define vec32_set1(x)		_mm_set1_epi32(x)
+#define vec32_and(a, b)		_mm_and_si128(a, b)
+#define vec32_or(a, b)		_mm_or_si128(a, b)
+#define vec32_xor(a, b)		_mm_xor_si128(a, b)
+#define vec32_srl(v, n)		_mm_srli_epi32(v, n)
+#define vec32_sll(v, n)		_mm_slli_epi32(v, n)
+#define vec32_sllv(v, n)	_mm_sll_epi32(v, _mm_cvtsi32_si128(n))
+#define vec32_add(a, b)		_mm_add_epi32(a, b)
+#define vec32_sub(a, b)		_mm_sub_epi32(a, b)
+#define vec32_mul16(a, b)	_mm_mullo_epi16(a, b)		/* lanes and products < 2^16 */
+#define vec32_min16(a, b)	_mm_min_epi16(a, b)		/* lanes < 2^15 */
+#define vec32_lt(a, b)		_mm_cmplt_epi32(a, b)		/* operands < 2^31 */
+#define vec32_eq(a, b)		_mm_cmpeq_epi32(a, b)
+#define vec32_select(m, a, b)	_mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define vec32_any(m)		(_mm_movemask_epi8(m) != 0)
+#define vec32_signbits(v)	_mm_movemask_ps(_mm_castsi128_ps(v))
+#define vec16_pack15(a, b)	_mm_packs_epi32(_mm_and_si128(a, _mm_set1_epi32(0x7fff)), \
+		_mm_and_si128(b, _mm_set1_epi32(0x7fff)))
+#define vec16_pack16(a, b)	_mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), \
+		_mm_srai_epi32(_mm_slli_epi32(b, 16), 16))
+#define vec16_store(p, v)	_mm_storeu_si128((__m128i *)(p), v)
+#define vec32_load16(p)		_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(p)), _mm_setzero_si128())
+#define vec16_and(v, x)		_mm_and_si128(v, _mm_set1_epi16(x))
+#define vec16_or(a, b)		_mm_or_si128(a, b)
+#define vec16_sll(v, n)		_mm_slli_epi16(v, n)
+#define vec16_srl(v, n)		_mm_srli_epi16(v, n)
+#elif defined(HAVE_NEON) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GFX_SIMD
+#define VEC32_LANES 4
+typedef uint32x4_t vec32;
+typedef uint16x8_t vec16;
+#define vec32_load(p)		vld1q_u32((const uint32_t *)(p))
+#define vec32_store(p, v)	vst1q_u32((uint32_t *)(p), v)
+#define vec32_set1(x)		vdupq_n_u32(x)
+#define vec32_and(a, b)		vandq_u32(a, b)
+#define vec32_or(a, b)		vorrq_u32(a, b)
+#define vec32_xor(a, b)		veorq_u32(a, b)
+#define vec32_srl(v, n)		vshrq_n_u32(v, n)
+#define vec32_sll(v, n)		vshlq_n_u32(v, n)
+#define vec32_sllv(v, n)	vshlq_u32(v, vdupq_n_s32(n))
+#define vec32_add(a, b)		vaddq_u32(a, b)
+#define vec32_sub(a, b)		vsubq_u32(a, b)
+#define vec32_mul16(a, b)	vmulq_u32(a, b)
+#define vec32_min16(a, b)	vminq_u32(a, b)
+#define vec32_lt(a, b)		vcltq_u32(a, b)
+#define vec32_eq(a, b)		vceqq_u32(a, b)
+#define vec32_select(m, a, b)	vbslq_u32(m, a, b)
+static INLINE bool vec32_any(vec32 m)
+{
+	uint32x2_t t = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+	return (vget_lane_u32(t, 0) | vget_lane_u32(t, 1)) != 0;
+}
+static INLINE int vec32_signbits(vec32 v)
+{
+	uint32x4_t b = vshrq_n_u32(v, 31);
+	return vgetq_lane_u32(b, 0) | (vgetq_lane_u32(b, 1) << 1) | (vgetq_lane_u32(b, 2) << 2) | (vgetq_lane_u32(b, 3) << 3);
+}
+#define vec16_pack15(a, b)	vandq_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b)), vdupq_n_u16(0x7fff))
+#define vec16_pack16(a, b)	vcombine_u16(vmovn_u32(a), vmovn_u32(b))
+#define vec16_store(p, v)	vst1q_u16((uint16_t *)(p), v)
+#define vec32_load16(p)		vmovl_u16(vld1_u16((const uint16_t *)(p)))
+#define vec16_and(v, x)		vandq_u16(v, vdupq_n_u16(x))
+#define vec16_or(a, b)		vorrq_u16(a, b)
+#define vec16_sll(v, n)		vshlq_n_u16(v, n)
+#define vec16_srl(v, n)		vshrq_n_u16(v, n)
+#endif
+
+#ifdef GFX_SIMD
+
+/* byte and halfword table lookups per lane; AVX2 has a gather, the
+ * others go through memory */
+#ifndef vec32_gather8
+static INLINE vec32 vec32_gather8(const u8 *p, vec32 i)
+{
+	u32 idx[VEC32_LANES], v[VEC32_LANES];
+	vec32_store(idx, i);
+	for(int k = 0; k < VEC32_LANES; k++)
+		v[k] = p[idx[k]];
+	return vec32_load(v);
+}
+
+static INLINE vec32 vec32_gather16(const u16 *p, vec32 i)
+{
+	u32 idx[VEC32_LANES], v[VEC32_LANES];
+	vec32_store(idx, i);
+	for(int k = 0; k < VEC32_LANES; k++)
+		v[k] = p[idx[k]];
+	return vec32_load(v);
+}
+#endif
+
+#ifndef vec32_gather32
+static INLINE vec32 vec32_gather32(const u32 *p, vec32 i)
+{
+	u32 idx[VEC32_LANES], v[VEC32_LANES];
+	vec32_store(idx, i);
+	for(int k = 0; k < VEC32_LANES; k++)
+		v[k] = p[idx[k]];
+	return vec32_load(v);
+}
+#endif
+
+/* CONVERT_COLOR on the low 15 bits of vec32 lanes: one vec32 of
+ * XRGB8888 pixels, or two packed into one vec16 of 16-bit pixels.
+ * Only AVX2 gathers; elsewhere colorLUT is read lane by lane, so the
+ * plain colours are worked out in the lanes (PIXEL_FROM_BGR555) and the
+ * table is left to colour correction. */
+#if defined(FRONTEND_SUPPORTS_XRGB8888)
+#define vec32_convert_lut(c)	vec32_gather32(colorLUT, vec32_and(c, vec32_set1(0x7fff)))
+#define vec32_mask(v, x)	vec32_and(v, vec32_set1(x))
+#define vec32_from_bgr555(c) \
+	vec32_or(vec32_or(vec32_or(vec32_sll(vec32_mask(c, 0x001f), 19), vec32_sll(vec32_mask(c, 0x001c), 14)), \
+		vec32_or(vec32_sll(vec32_mask(c, 0x03e0), 6), vec32_sll(vec32_mask(c, 0x0380), 1))), \
+		vec32_or(vec32_srl(vec32_mask(c, 0x7c00), 7), vec32_srl(vec32_mask(c, 0x7000), 12)))
+#ifdef __AVX2__
+#define vec32_convert_color(c)	vec32_convert_lut(c)
+#else
+#define vec32_convert_color(c)	(colorCorrection ? vec32_convert_lut(c) : vec32_from_bgr555(c))
+#endif
+#else
+#define vec16_convert_lut(a, b)	vec16_pack16(vec32_gather16(colorLUT, vec32_and(a, vec32_set1(0x7fff))), \
+		vec32_gather16(colorLUT, vec32_and(b, vec32_set1(0x7fff))))
+#ifdef __AVX2__
+#define vec16_convert_color(a, b) vec16_convert_lut(a, b)
+#else
+#if defined(FRONTEND_SUPPORTS_RGB565)
+#define vec16_from_bgr555(c) \
+	vec16_or(vec16_or(vec16_sll(vec16_and(c, 0x001f), 11), vec16_sll(vec16_and(c, 0x03e0), 1)), \
+		vec16_or(vec16_srl(vec16_and(c, 0x0200), 4), vec16_srl(vec16_and(c, 0x7c00), 10)))
+#else
+#define vec16_from_bgr555(c) \
+	vec16_or(vec16_or(vec16_sll(vec16_and(c, 0x001f), 10), vec16_and(c, 0x03e0)), \
+		vec16_srl(vec16_and(c, 0x7c00), 10))
+#endif
+#define vec16_convert_color(a, b) (colorCorrection ? vec16_convert_lut(a, b) : vec16_from_bgr555(vec16_pack15(a, b)))
+#endif
+#endif
+
+#endif
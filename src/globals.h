@@ -2,6 +2,7 @@
 #define GLOBALS_H
 
 #include "types.h"
+#include "port.h"
 
 extern int saveType;
 extern bool useBios;
@@ -19,7 +20,9 @@ extern u8 *rom;
 extern u8 *internalRAM;
 extern u8 *workRAM;
 extern u8 *vram;
-extern u16 *pix;
+extern pixel_t *pix;
+extern pixel_t *pixOut;
+extern unsigned pixPitch;
 extern u8 *oam;
 extern u8 *ioMem;
 
@@ -38,6 +38,8 @@ extern void eepromSaveGameMem(uint8_t *&data);
 
 extern int eepromRead(void);
 extern void eepromWrite(u8 value);
+extern bool eepromWriteBlock(const u16 *stream, int count);
+extern bool eepromReadBlock(u16 *stream, int count);
 extern void eepromInit(void);
 extern void eepromReset(void);
 
@@ -13,7 +13,20 @@
 
 #include "types.h"
 
-#ifdef FRONTEND_SUPPORTS_RGB565
+#if defined(FRONTEND_SUPPORTS_XRGB8888)
+/* 32bit color - XRGB8888 */
+#define RED_MASK  0xff0000
+#define GREEN_MASK 0xff00
+#define BLUE_MASK 0xff
+#define RED_EXPAND 0
+#define GREEN_EXPAND 0
+#define BLUE_EXPAND 0
+#define RED_SHIFT 16
+#define GREEN_SHIFT 8
+#define BLUE_SHIFT 0
+#define PIXEL_AVG_MASK 0xfefefefe
+#define PIXEL_FROM_BGR555(color) (((color & 0x001f) << 19) | ((color & 0x001c) << 14) | ((color & 0x03e0) << 6) | ((color & 0x0380) << 1) | ((color & 0x7c00) >> 7) | ((color & 0x7000) >> 12))
+#elif defined(FRONTEND_SUPPORTS_RGB565)
 /* 16bit color - RGB565 */
 #define RED_MASK  0xf800
 #define GREEN_MASK 0x7e0
@@ -24,7 +37,8 @@
 #define RED_SHIFT 11
 #define GREEN_SHIFT 5
 #define BLUE_SHIFT 0
-#define CONVERT_COLOR(color) (((color & 0x001f) << 11) | ((color & 0x03e0) << 1) | ((color & 0x0200) >> 4) | ((color & 0x7c00) >> 10))
+#define PIXEL_AVG_MASK 0xf7def7de
+#define PIXEL_FROM_BGR555(color) (((color & 0x001f) << 11) | ((color & 0x03e0) << 1) | ((color & 0x0200) >> 4) | ((color & 0x7c00) >> 10))
 #else
 /* 16bit color - RGB555 */
 #define RED_MASK  0x7c00
@@ -36,9 +50,23 @@
 #define RED_SHIFT 10
 #define GREEN_SHIFT 5
 #define BLUE_SHIFT 0
-#define CONVERT_COLOR(color) ((((color & 0x1f) << 10) | (((color & 0x3e0) >> 5) << 5) | (((color & 0x7c00) >> 10))) & 0x7fff)
+#define PIXEL_AVG_MASK 0x7bde7bde
+#define PIXEL_FROM_BGR555(color) ((((color & 0x1f) << 10) | (((color & 0x3e0) >> 5) << 5) | (((color & 0x7c00) >> 10))) & 0x7fff)
 #endif
 
+/* one pixel of pix, in the frontend format */
+#ifdef FRONTEND_SUPPORTS_XRGB8888
+typedef u32 pixel_t;
+#else
+typedef u16 pixel_t;
+#endif
+
+/* BGR555 to the frontend format through a table built at init, plain
+ * (PIXEL_FROM_BGR555) or LCD colour corrected. Bits above 15 are
+ * ignored; the spare entries let vector gathers read past the end. */
+extern pixel_t colorLUT[0x8000 + 2];
+#define CONVERT_COLOR(color) (colorLUT[(color) & 0x7fff])
+
 #ifdef _MSC_VER
 #include <stdlib.h>
 #define strcasecmp _stricmp
@@ -67,9 +67,10 @@ class Blip_Buffer
 		int length_;		/* Length of buffer in milliseconds*/
 		long sample_rate_;	/* Current output sample rate*/
 		uint32_t factor_;
-		uint32_t offset_;
+		uint32_t offset_;	/* end of the samples written, from read_pos_ */
 		int32_t * buffer_;
-		int32_t buffer_size_;
+		int32_t buffer_size_;	/* a power of two; positions wrap around it */
+		int32_t read_pos_;	/* next sample to read */
 		int32_t reader_accum_;
 		Blip_Buffer();
 		~Blip_Buffer();
@@ -238,19 +239,22 @@ INLINE void Blip_Synth::offset_resampled( uint32_t time, int delta, Blip_Buffer*
 	int32_t left, right, phase;
 	int32_t *buf;
 
+	int32_t mask = blip_buf->buffer_size_ - 1;
+	int32_t pos = (blip_buf->read_pos_ + (time >> BLIP_BUFFER_ACCURACY)) & mask;
+
 	delta *= delta_factor;
-	buf = blip_buf->buffer_ + (time >> BLIP_BUFFER_ACCURACY);
+	buf = blip_buf->buffer_;
 	phase = (int) (time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) & BLIP_RES_MIN_ONE);
 
-	left = buf [0] + delta;
+	left = buf [pos] + delta;
 
 	right = (delta >> BLIP_PHASE_BITS) * phase;
 
 	left  -= right;
-	right += buf [1];
+	right += buf [(pos + 1) & mask];
 
-	buf [0] = left;
-	buf [1] = right;
+	buf [pos] = left;
+	buf [(pos + 1) & mask] = right;
 }
 
 INLINE void Blip_Synth::offset( int32_t t, int delta, Blip_Buffer* buf ) const
@@ -291,8 +295,12 @@ static int16_t   soundFinalWave [1600];
 long  soundSampleRate    = 22050;
 int   SOUND_CLOCK_TICKS  = SOUND_CLOCK_TICKS_;
 int   soundTicks         = SOUND_CLOCK_TICKS_;
+static int soundFlushTicks   = SOUND_CLOCK_TICKS_; /* SOUND_CLOCK_TICKS from the next tick on*/
+static int soundFlushRequest = SOUND_CLOCK_TICKS_; /* as set, before clamping to the sample rate*/
+static void soundClampFlushTicks(void);
 
 static int soundEnableFlag   = 0x3ff; /* emulator channels enabled*/
+static bool soundHeadless    = false; /* run the hardware, synthesize nothing*/
 static float const apu_vols [4] = { -0.25f, -0.5f, -1.0f, -0.25f };
 
 static const int table [0x40] =
@@ -373,7 +381,7 @@ static void gba_pcm_apply_control( int pcm_idx, int idx )
 
 	if ( pcm[pcm_idx].pcm.output != out )
 	{
-		if ( pcm[pcm_idx].pcm.output )
+		if ( pcm[pcm_idx].pcm.output && !soundHeadless )
 			pcm_synth.offset( SOUND_CLOCK_TICKS - soundTicks, -pcm[pcm_idx].pcm.last_amp, pcm[pcm_idx].pcm.output );
 		pcm[pcm_idx].pcm.last_amp = 0;
 		pcm[pcm_idx].pcm.output = out;
@@ -419,6 +427,106 @@ static void stereo_buffer_clear (void)
 	bufs_buffer [0].clear();
 }
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIXER_SSE2
+#elif defined(HAVE_NEON) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIXER_NEON
+#endif
+
+#if defined(MIXER_SSE2) || defined(MIXER_NEON)
+/* Mixes pairs 8 at a time in one pass for both channels, the left,
+ * right and center readers integrating side by side in the lanes of
+ * one vector. The saturating pack matches BLIP_CLAMP, since a sum
+ * shifted down by 14 stays well inside 24 bits. Returns the number of
+ * pairs done; the scalar mixer finishes the rest. */
+static int stereo_buffer_mixer_read_pairs_simd( int16_t* out, int count )
+{
+	const int32_t* l = bufs_buffer[0].buffer_ + bufs_buffer[0].read_pos_ + mixer_samples_read;
+	const int32_t* r = bufs_buffer[1].buffer_ + bufs_buffer[1].read_pos_ + mixer_samples_read;
+	const int32_t* c = bufs_buffer[2].buffer_ + bufs_buffer[2].read_pos_ + mixer_samples_read;
+	int i = 0;
+
+#ifdef MIXER_SSE2
+	__m128i zero = _mm_setzero_si128();
+	__m128i acc = _mm_set_epi32( 0, bufs_buffer[2].reader_accum_,
+			bufs_buffer[1].reader_accum_, bufs_buffer[0].reader_accum_ );
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m128i sum [8];
+		for ( int h = 0; h < 8; h += 4 )
+		{
+			__m128i vl = _mm_loadu_si128( (const __m128i*) &l [i + h] );
+			__m128i vr = _mm_loadu_si128( (const __m128i*) &r [i + h] );
+			__m128i vc = _mm_loadu_si128( (const __m128i*) &c [i + h] );
+			__m128i lr01 = _mm_unpacklo_epi32( vl, vr );
+			__m128i lr23 = _mm_unpackhi_epi32( vl, vr );
+			__m128i c01 = _mm_unpacklo_epi32( vc, zero );
+			__m128i c23 = _mm_unpackhi_epi32( vc, zero );
+			__m128i in [4] = {
+				_mm_unpacklo_epi64( lr01, c01 ), _mm_unpackhi_epi64( lr01, c01 ),
+				_mm_unpacklo_epi64( lr23, c23 ), _mm_unpackhi_epi64( lr23, c23 )
+			};
+			for ( int k = 0; k < 4; k++ )
+			{
+				sum [h + k] = _mm_add_epi32( acc, _mm_shuffle_epi32( acc, 0xAA ) );
+				acc = _mm_sub_epi32( acc, _mm_srai_epi32( acc, BLIP_READER_DEFAULT_BASS ) );
+				acc = _mm_add_epi32( acc, in [k] );
+			}
+		}
+		for ( int k = 0; k < 8; k += 4 )
+		{
+			__m128i a = _mm_srai_epi32( _mm_unpacklo_epi64( sum [k], sum [k + 1] ), 14 );
+			__m128i b = _mm_srai_epi32( _mm_unpacklo_epi64( sum [k + 2], sum [k + 3] ), 14 );
+			_mm_storeu_si128( (__m128i*) &out [(i + k) * STEREO], _mm_packs_epi32( a, b ) );
+		}
+	}
+	int32_t accum [4];
+	_mm_storeu_si128( (__m128i*) accum, acc );
+#else
+	int32x4_t zero = vdupq_n_s32( 0 );
+	int32_t accum [4] = { bufs_buffer[0].reader_accum_, bufs_buffer[1].reader_accum_,
+			bufs_buffer[2].reader_accum_, 0 };
+	int32x4_t acc = vld1q_s32( accum );
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		int32x4_t sum [8];
+		for ( int h = 0; h < 8; h += 4 )
+		{
+			int32x4x2_t lr = vzipq_s32( vld1q_s32( &l [i + h] ), vld1q_s32( &r [i + h] ) );
+			int32x4x2_t cz = vzipq_s32( vld1q_s32( &c [i + h] ), zero );
+			int32x4_t in [4] = {
+				vcombine_s32( vget_low_s32( lr.val [0] ), vget_low_s32( cz.val [0] ) ),
+				vcombine_s32( vget_high_s32( lr.val [0] ), vget_high_s32( cz.val [0] ) ),
+				vcombine_s32( vget_low_s32( lr.val [1] ), vget_low_s32( cz.val [1] ) ),
+				vcombine_s32( vget_high_s32( lr.val [1] ), vget_high_s32( cz.val [1] ) )
+			};
+			for ( int k = 0; k < 4; k++ )
+			{
+				sum [h + k] = vaddq_s32( acc, vdupq_lane_s32( vget_high_s32( acc ), 0 ) );
+				acc = vsubq_s32( acc, vshrq_n_s32( acc, BLIP_READER_DEFAULT_BASS ) );
+				acc = vaddq_s32( acc, in [k] );
+			}
+		}
+		for ( int k = 0; k < 8; k += 4 )
+		{
+			int32x4_t a = vshrq_n_s32( vcombine_s32( vget_low_s32( sum [k] ), vget_low_s32( sum [k + 1] ) ), 14 );
+			int32x4_t b = vshrq_n_s32( vcombine_s32( vget_low_s32( sum [k + 2] ), vget_low_s32( sum [k + 3] ) ), 14 );
+			vst1q_s16( &out [(i + k) * STEREO], vcombine_s16( vqmovn_s32( a ), vqmovn_s32( b ) ) );
+		}
+	}
+	vst1q_s32( accum, acc );
+#endif
+
+	bufs_buffer[0].reader_accum_ = accum [0];
+	bufs_buffer[1].reader_accum_ = accum [1];
+	bufs_buffer[2].reader_accum_ = accum [2];
+	mixer_samples_read += i;
+	return i;
+}
+#endif
+
 /* mixers use a single index value to improve performance on register-challenged processors
  * offset goes from negative to zero*/
 
@@ -427,6 +535,13 @@ static INLINE void stereo_buffer_mixer_read_pairs( int16_t* out, int count )
 	/* TODO: if caller never marks buffers as modified, uses mono*/
 	/* except that buffer isn't cleared, so caller can encounter*/
 	/* subtle problems and not realize the cause.*/
+#if defined(MIXER_SSE2) || defined(MIXER_NEON)
+	int done = stereo_buffer_mixer_read_pairs_simd( out, count );
+	out += done * STEREO;
+	count -= done;
+	if ( !count )
+		return;
+#endif
 	mixer_samples_read += count;
 	int16_t* outtemp = out + count * STEREO;
 
@@ -485,26 +600,20 @@ static INLINE void stereo_buffer_mixer_read_pairs( int16_t* out, int count )
 	}
 }
 
+/* The samples read are cleared for the writer to add into again when
+ * it comes round; nothing moves. count must not cross the end of the
+ * buffers, which all wrap at the same place. */
 static void blip_buffer_remove_all_samples( long count )
 {
 	uint32_t new_offset = (uint32_t)count << BLIP_BUFFER_ACCURACY;
-	/* BLIP BUFFER #1 */
-	bufs_buffer[0].offset_ -= new_offset;
-	bufs_buffer[1].offset_ -= new_offset;
-	bufs_buffer[2].offset_ -= new_offset;
-
-	/* copy remaining samples to beginning and clear old samples*/
-	long remain = (bufs_buffer[0].offset_ >> BLIP_BUFFER_ACCURACY) + BLIP_BUFFER_EXTRA_;
-	memmove( bufs_buffer[0].buffer_, bufs_buffer[0].buffer_ + count, remain * sizeof *bufs_buffer[0].buffer_ );
-	memset( bufs_buffer[0].buffer_ + remain, 0, count * sizeof(*bufs_buffer[0].buffer_));
-
-	remain = (bufs_buffer[1].offset_ >> BLIP_BUFFER_ACCURACY) + BLIP_BUFFER_EXTRA_;
-	memmove( bufs_buffer[1].buffer_, bufs_buffer[1].buffer_ + count, remain * sizeof *bufs_buffer[1].buffer_ );
-	memset( bufs_buffer[1].buffer_ + remain, 0, count * sizeof(*bufs_buffer[1].buffer_));
 
-	remain = (bufs_buffer[2].offset_ >> BLIP_BUFFER_ACCURACY) + BLIP_BUFFER_EXTRA_;
-	memmove( bufs_buffer[2].buffer_, bufs_buffer[2].buffer_ + count, remain * sizeof *bufs_buffer[2].buffer_ );
-	memset( bufs_buffer[2].buffer_ + remain, 0, count * sizeof(*bufs_buffer[2].buffer_));
+	for ( int i = 0; i < BUFS_SIZE; i++ )
+	{
+		Blip_Buffer* b = &bufs_buffer[i];
+		memset( b->buffer_ + b->read_pos_, 0, count * sizeof *b->buffer_ );
+		b->read_pos_ = (b->read_pos_ + count) & (b->buffer_size_ - 1);
+		b->offset_ -= new_offset;
+	}
 }
 
 static long stereo_buffer_read_samples( int16_t * out, long out_size )
@@ -514,11 +623,18 @@ static long stereo_buffer_read_samples( int16_t * out, long out_size )
         out_size = (STEREO_BUFFER_SAMPLES_AVAILABLE() < out_size) ? STEREO_BUFFER_SAMPLES_AVAILABLE() : out_size;
 
         pair_count = int (out_size >> 1);
-        if ( pair_count )
+	while ( pair_count )
 	{
-		stereo_buffer_mixer_read_pairs( out, pair_count );
+		/* up to where the buffers wrap */
+		int count = bufs_buffer[0].buffer_size_ - bufs_buffer[0].read_pos_;
+		if ( count > pair_count )
+			count = pair_count;
+
+		stereo_buffer_mixer_read_pairs( out, count );
 		blip_buffer_remove_all_samples( mixer_samples_read );
 		mixer_samples_read = 0;
+		out += count * STEREO;
+		pair_count -= count;
 	}
         return out_size;
 }
@@ -554,7 +670,7 @@ static void pcm_fifo_write_control( int data, int data2)
 
 		pcm[0].dac = (int8_t)pcm[0].dac >> pcm[0].pcm.shift;
 		int delta = pcm[0].dac - pcm[0].pcm.last_amp;
-		if ( delta )
+		if ( delta && !soundHeadless )
 		{
 			pcm[0].pcm.last_amp = pcm[0].dac;
 			pcm_synth.offset( time, delta, pcm[0].pcm.output );
@@ -583,7 +699,7 @@ static void pcm_fifo_write_control( int data, int data2)
 
 		pcm[1].dac = (int8_t)pcm[1].dac >> pcm[1].pcm.shift;
 		int delta = pcm[1].dac - pcm[1].pcm.last_amp;
-		if ( delta )
+		if ( delta && !soundHeadless )
 		{
 			pcm[1].pcm.last_amp = pcm[1].dac;
 			pcm_synth.offset( time, delta, pcm[1].pcm.output );
@@ -670,7 +786,7 @@ static void gba_pcm_fifo_timer_overflowed( unsigned pcm_idx )
 
 		pcm[pcm_idx].dac = (int8_t)pcm[pcm_idx].dac >> pcm[pcm_idx].pcm.shift;
 		int delta = pcm[pcm_idx].dac - pcm[pcm_idx].pcm.last_amp;
-		if ( delta )
+		if ( delta && !soundHeadless )
 		{
 			pcm[pcm_idx].pcm.last_amp = pcm[pcm_idx].dac;
 			pcm_synth.offset( time, delta, pcm[pcm_idx].pcm.output );
@@ -785,15 +901,34 @@ void process_sound_tick_fn (void)
 	gb_apu.frame_time -= SOUND_CLOCK_TICKS;
 	gb_apu.last_time -= SOUND_CLOCK_TICKS;
 
-	bufs_buffer[2].offset_ += SOUND_CLOCK_TICKS * bufs_buffer[2].factor_;
-	bufs_buffer[1].offset_ += SOUND_CLOCK_TICKS * bufs_buffer[1].factor_;
-	bufs_buffer[0].offset_ += SOUND_CLOCK_TICKS * bufs_buffer[0].factor_;
+	// nothing was synthesized, so nothing to read out
+	if ( !soundHeadless )
+	{
+		bufs_buffer[2].offset_ += SOUND_CLOCK_TICKS * bufs_buffer[2].factor_;
+		bufs_buffer[1].offset_ += SOUND_CLOCK_TICKS * bufs_buffer[1].factor_;
+		bufs_buffer[0].offset_ += SOUND_CLOCK_TICKS * bufs_buffer[0].factor_;
+
+		// dump all the samples available; the fraction of a sample
+		// left over stays in offset_ for the next tick
+		int numSamples = stereo_buffer_read_samples( (int16_t*) soundFinalWave, stereo_buffer_samples_avail());
+		systemOnWriteDataToSoundBuffer(soundFinalWave, numSamples);
+	}
 
+	SOUND_CLOCK_TICKS = soundFlushTicks;
+}
 
-	// dump all the samples available
-	// VBA will only ever store 1 frame worth of samples
-	int numSamples = stereo_buffer_read_samples( (int16_t*) soundFinalWave, stereo_buffer_samples_avail());
-	systemOnWriteDataToSoundBuffer(soundFinalWave, numSamples);
+/* Oscillators without an output keep their phase but synthesize
+ * nothing, which is all headless mode needs from them. */
+static void gb_apu_apply_outputs (void)
+{
+	Blip_Buffer* center = soundHeadless ? 0 : &bufs_buffer[2];
+	Blip_Buffer* left   = soundHeadless ? 0 : &bufs_buffer[0];
+	Blip_Buffer* right  = soundHeadless ? 0 : &bufs_buffer[1];
+
+	gb_apu_set_output( center, left, right, 0 );
+	gb_apu_set_output( center, left, right, 1 );
+	gb_apu_set_output( center, left, right, 2 );
+	gb_apu_set_output( center, left, right, 3 );
 }
 
 static void apply_muting (void)
@@ -803,13 +938,22 @@ static void apply_muting (void)
 	gba_pcm_apply_control(1, 1 );
 
 	// APU
-	gb_apu_set_output( &bufs_buffer[2], &bufs_buffer[0], &bufs_buffer[1], 0 );
-	gb_apu_set_output( &bufs_buffer[2], &bufs_buffer[0], &bufs_buffer[1], 1 );
-	gb_apu_set_output( &bufs_buffer[2], &bufs_buffer[0], &bufs_buffer[1], 2 );
-	gb_apu_set_output( &bufs_buffer[2], &bufs_buffer[0], &bufs_buffer[1], 3 );
+	gb_apu_apply_outputs();
 }
 
 
+
+/* The ring has to take a whole flush interval on top of
+ * BLIP_BUFFER_EXTRA_, and soundClampFlushTicks() lets one interval fill
+ * soundFinalWave; below 16 kHz that is more than BLIP_DEFAULT_LENGTH. */
+static int stereo_buffer_length (void)
+{
+	long pairs = sizeof soundFinalWave / sizeof *soundFinalWave / STEREO;
+	int msec = (int) ((pairs * 1000 + soundSampleRate - 1) / soundSampleRate);
+
+	return msec > BLIP_DEFAULT_LENGTH ? msec : BLIP_DEFAULT_LENGTH;
+}
+
 static void remake_stereo_buffer (void)
 {
 	if ( !ioMem )
@@ -821,8 +965,10 @@ static void remake_stereo_buffer (void)
 	// Stereo_Buffer
 
         mixer_samples_read = 0;
-	stereo_buffer_set_sample_rate( soundSampleRate, BLIP_DEFAULT_LENGTH );
+	stereo_buffer_set_sample_rate( soundSampleRate, stereo_buffer_length() );
 	stereo_buffer_clock_rate( CLOCK_RATE );
+	soundClampFlushTicks();
+	SOUND_CLOCK_TICKS = soundFlushTicks;
 
 	// PCM
 	pcm [0].which = 0;
@@ -854,8 +1000,8 @@ void soundReset (void)
 	soundTicks = SOUND_CLOCK_TICKS;
 	//End of Reset APU
 
-	SOUND_CLOCK_TICKS = SOUND_CLOCK_TICKS_;
-	soundTicks        = SOUND_CLOCK_TICKS_;
+	SOUND_CLOCK_TICKS = soundFlushTicks;
+	soundTicks        = soundFlushTicks;
 
 	// Sound Event (NR52)
 	int gb_addr = table[NR52 - 0x60];
@@ -872,11 +1018,60 @@ void soundReset (void)
 	// End of Sound Event (NR52)
 }
 
+void soundSetHeadless(bool headless)
+{
+	if ( soundHeadless == headless )
+		return;
+	soundHeadless = headless;
+
+	if ( !ioMem )
+		return;
+
+	// the buffers restart from silence
+	for ( int i = 0; i < OSC_COUNT; i++ )
+		gb_apu.oscs [i]->last_amp = 0;
+	pcm[0].pcm.last_amp = 0;
+	pcm[1].pcm.last_amp = 0;
+
+	gb_apu_apply_outputs();
+	stereo_buffer_clear();
+}
+
+/* down to a scanline (1232), up to what both soundFinalWave and the
+ * Blip_Buffer ring (past its BLIP_BUFFER_EXTRA_) hold at the current
+ * sample rate */
+static void soundClampFlushTicks(void)
+{
+	int pairs = sizeof soundFinalWave / sizeof *soundFinalWave / STEREO - 1;
+	int ring = bufs_buffer[0].buffer_size_ - BLIP_BUFFER_EXTRA_ - 1;
+	if ( bufs_buffer[0].buffer_size_ && ring < pairs )
+		pairs = ring;
+	int max = (int) ((int64_t) pairs * CLOCK_RATE / soundSampleRate);
+	int ticks = soundFlushRequest;
+
+	if ( ticks > max )
+		ticks = max;
+	if ( ticks < 1232 )
+		ticks = 1232;
+	soundFlushTicks = ticks;
+}
+
+/* Clocks of sound per systemOnWriteDataToSoundBuffer() call, from the
+ * next one on. */
+void soundSetFlushTicks(int ticks)
+{
+	soundFlushRequest = ticks;
+	soundClampFlushTicks();
+}
+
 void soundSetSampleRate(long sampleRate)
 {
 	if ( soundSampleRate != sampleRate )
 	{
 		soundSampleRate      = sampleRate;
+		// the buffers start over, and so does the interval
+		soundClampFlushTicks();
+		SOUND_CLOCK_TICKS = soundFlushTicks;
 		remake_stereo_buffer();
 	}
 }
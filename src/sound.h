@@ -17,7 +17,7 @@
 #define BLIP_RES_MIN_ONE 255
 #define BLIP_SAMPLE_BITS 30
 #define BLIP_READER_DEFAULT_BASS 9
-#define BLIP_DEFAULT_LENGTH 250		/* 1/4th of a second */
+#define BLIP_DEFAULT_LENGTH 50		/* 1/20th of a second, at least */
 
 #define BUFS_SIZE 3
 #define STEREO 2
@@ -59,7 +59,7 @@ struct blip_buffer_state_t
 
 /* Begins reading from buffer. Name should be unique to the current block.*/
 #define BLIP_READER_BEGIN( name, blip_buffer ) \
-        const int32_t * name##_reader_buf = (blip_buffer).buffer_;\
+        const int32_t * name##_reader_buf = (blip_buffer).buffer_ + (blip_buffer).read_pos_;\
         int32_t name##_reader_accum = (blip_buffer).reader_accum_
 
 /* Advances to next sample*/
@@ -117,6 +117,8 @@ void soundSetVolume( float );
 void soundPause (void);
 void soundResume (void);
 void soundSetSampleRate(long sampleRate);
+void soundSetHeadless(bool headless);
+void soundSetFlushTicks(int ticks);
 void soundReset (void);
 void soundEvent_u8( int gb_addr, uint32_t addr, uint8_t  data );
 void soundEvent_u8_parallel(int gb_addr[], uint32_t address[], uint8_t data[]);
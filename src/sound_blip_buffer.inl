@@ -29,27 +29,29 @@ Blip_Buffer::~Blip_Buffer()
 void Blip_Buffer::clear( void)
 {
    offset_       = 0;
+   read_pos_     = 0;
    reader_accum_ = 0;
 
    if ( buffer_ )
-      memset( buffer_, 0, (buffer_size_ + BLIP_BUFFER_EXTRA_) * sizeof (int32_t) );
+      memset( buffer_, 0, buffer_size_ * sizeof (int32_t) );
 }
 
 const char * Blip_Buffer::set_sample_rate( long new_rate, int msec )
 {
-   /* start with maximum length that resampled time can represent*/
-   long new_size = (ULONG_MAX >> BLIP_BUFFER_ACCURACY) - BLIP_BUFFER_EXTRA_ - 64;
+   /* start with maximum length that resampled time can represent, and
+    * halve it while it still holds msec and the widest impulse */
+   long new_size = 1L << (32 - BLIP_BUFFER_ACCURACY);
 
    if ( msec != 0)
    {
-      long s = (new_rate * (msec + 1) + 999) / 1000;
-      if ( s < new_size )
-	      new_size = s;
+      long s = (new_rate * (msec + 1) + 999) / 1000 + BLIP_BUFFER_EXTRA_;
+      while ( (new_size >> 1) >= s )
+	      new_size >>= 1;
    }
 
    if ( buffer_size_ != new_size )
    {
-      void* p = realloc( buffer_, (new_size + BLIP_BUFFER_EXTRA_) * sizeof *buffer_ );
+      void* p = realloc( buffer_, new_size * sizeof *buffer_ );
       if ( !p )
          return "Out of memory";
       buffer_ = (int32_t *) p;
@@ -83,7 +85,8 @@ void Blip_Buffer::save_state( blip_buffer_state_t* out )
 {
    out->offset_       = offset_;
    out->reader_accum_ = reader_accum_;
-   memcpy( out->buf, &buffer_ [offset_ >> BLIP_BUFFER_ACCURACY], sizeof out->buf );
+   for ( int i = 0; i < BLIP_BUFFER_EXTRA_; i++ )
+      out->buf [i] = buffer_ [(read_pos_ + (offset_ >> BLIP_BUFFER_ACCURACY) + i) & (buffer_size_ - 1)];
 }
 
 void Blip_Buffer::load_state( blip_buffer_state_t const& in )